@@ -0,0 +1,104 @@
+#include "connect_timing.h"
+#include <algorithm>
+
+ConnectTimingLog* ConnectTimingLog::instance = nullptr;
+
+uint32_t ConnectTiming::getTotalMs() const {
+  uint32_t total = 0;
+  for (uint32_t ms : phaseMs) {
+    total += ms;
+  }
+  return total;
+}
+
+// ---------------------------------------------------------------------------------------
+// ------------------------------   ConnectTimingLog    ----------------------------------
+// ---------------------------------------------------------------------------------------
+
+void ConnectTimingLog::add(const ConnectTiming& timing) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (timings.size() < CAPACITY) {
+    timings.push_back(timing);
+  }
+  else {
+    timings[next] = timing;
+  }
+  next = (next + 1) % CAPACITY;
+}
+
+std::vector<ConnectTiming> ConnectTimingLog::getTimings() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (timings.size() < CAPACITY) {
+    return timings;
+  }
+  std::vector<ConnectTiming> ordered(timings.begin() + next, timings.end());
+  ordered.insert(ordered.end(), timings.begin(), timings.begin() + next);
+  return ordered;
+}
+
+std::vector<PluginConnectSummary> ConnectTimingLog::getPluginSummaries() {
+  std::vector<PluginConnectSummary> summaries;
+  std::vector<uint64_t> phaseTotals;
+  for (const auto& timing : getTimings()) {
+    size_t index = 0;
+    while (index < summaries.size() && summaries[index].pluginId != timing.pluginId) {
+      index++;
+    }
+    if (index == summaries.size()) {
+      summaries.emplace_back();
+      summaries.back().pluginId = timing.pluginId;
+      phaseTotals.resize(phaseTotals.size() + CONNECT_PHASE_COUNT, 0);
+    }
+
+    PluginConnectSummary& summary = summaries[index];
+    summary.connections++;
+    if (!timing.succeeded) {
+      continue;
+    }
+    uint32_t totalMs = timing.getTotalMs();
+    summary.minTimeToFirstWeightMs = summary.succeeded == 0 ? totalMs : std::min(summary.minTimeToFirstWeightMs, totalMs);
+    summary.maxTimeToFirstWeightMs = std::max(summary.maxTimeToFirstWeightMs, totalMs);
+    summary.succeeded++;
+    for (size_t phase = 0; phase < CONNECT_PHASE_COUNT; phase++) {
+      phaseTotals[index * CONNECT_PHASE_COUNT + phase] += timing.phaseMs[phase];
+    }
+  }
+
+  for (size_t index = 0; index < summaries.size(); index++) {
+    PluginConnectSummary& summary = summaries[index];
+    if (summary.succeeded == 0) {
+      continue;
+    }
+    uint64_t total = 0;
+    for (size_t phase = 0; phase < CONNECT_PHASE_COUNT; phase++) {
+      uint64_t phaseTotal = phaseTotals[index * CONNECT_PHASE_COUNT + phase];
+      summary.averagePhaseMs[phase] = phaseTotal / summary.succeeded;
+      total += phaseTotal;
+    }
+    summary.averageTimeToFirstWeightMs = total / summary.succeeded;
+  }
+  return summaries;
+}
+
+std::string ConnectTimingLog::formatReport() {
+  std::string report = "plugin               ok/n   avg ms   min ms   max ms | link  disc  char  subs  hand  1st\n";
+  char line[128];
+  for (const auto& summary : getPluginSummaries()) {
+    snprintf(line, sizeof(line), "%-20s %2u/%-2u %8u %8u %8u | %4u %5u %5u %5u %5u %4u\n",
+      summary.pluginId.c_str(), summary.succeeded, summary.connections,
+      static_cast<unsigned>(summary.averageTimeToFirstWeightMs),
+      static_cast<unsigned>(summary.minTimeToFirstWeightMs),
+      static_cast<unsigned>(summary.maxTimeToFirstWeightMs),
+      static_cast<unsigned>(summary.averagePhaseMs[0]), static_cast<unsigned>(summary.averagePhaseMs[1]),
+      static_cast<unsigned>(summary.averagePhaseMs[2]), static_cast<unsigned>(summary.averagePhaseMs[3]),
+      static_cast<unsigned>(summary.averagePhaseMs[4]), static_cast<unsigned>(summary.averagePhaseMs[5]));
+    report += line;
+  }
+  return report;
+}
+
+void ConnectTimingLog::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  timings.clear();
+  next = 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+enum class ConnectPhase : uint8_t {
+  CLIENT_CONNECT,     // Establishing the link
+  SERVICE_DISCOVERY,
+  CHARACTERISTICS,    // Looking up the characteristics in the service
+  SUBSCRIBE,          // CCCD writes and registering for notifications
+  HANDSHAKE,          // Protocol writes after subscribing, i.e. identify or notification requests
+  FIRST_WEIGHT,       // Waiting for the first weight notification
+};
+constexpr size_t CONNECT_PHASE_COUNT = 6;
+
+// How long each phase of one connection took. Drivers mark the phases they go through; the time of a
+// phase a driver doesn't mark is counted in the next one it does.
+struct ConnectTiming {
+  std::string pluginId;
+  std::string deviceName;
+  uint32_t startedAt = 0;  // millis()
+  uint32_t phaseMs[CONNECT_PHASE_COUNT] = {};
+  bool succeeded = false;  // Reached the first weight
+  ConnectPhase lastPhase = ConnectPhase::CLIENT_CONNECT;  // The last phase that was completed
+
+  uint32_t getPhaseMs(ConnectPhase phase) const { return phaseMs[static_cast<size_t>(phase)]; }
+  uint32_t getTotalMs() const;
+};
+
+// The connections of one plugin in the log, summed up.
+struct PluginConnectSummary {
+  std::string pluginId;
+  uint16_t connections = 0;
+  uint16_t succeeded = 0;
+  uint32_t minTimeToFirstWeightMs = 0;
+  uint32_t maxTimeToFirstWeightMs = 0;
+  uint32_t averageTimeToFirstWeightMs = 0;
+  uint32_t averagePhaseMs[CONNECT_PHASE_COUNT] = {};  // Over the successful connections
+};
+
+// Keeps the timings of the last CAPACITY connections of all scales, so they survive the scales being destroyed.
+class ConnectTimingLog {
+public:
+  static constexpr size_t CAPACITY = 16;
+
+  void add(const ConnectTiming& timing);
+  // Oldest first.
+  std::vector<ConnectTiming> getTimings();
+  void clear();
+
+  // One summary per plugin, in the order the plugins first appear in the log.
+  std::vector<PluginConnectSummary> getPluginSummaries();
+  // The summaries as a table with one line per plugin, i.e. to log after a round of connecting to each scale.
+  std::string formatReport();
+
+  static ConnectTimingLog* getInstance() {
+    if (instance == nullptr) {
+      instance = new ConnectTimingLog();
+    }
+    return instance;
+  }
+
+  ConnectTimingLog(ConnectTimingLog& other) = delete;
+  void operator=(const ConnectTimingLog&) = delete;
+
+private:
+  static ConnectTimingLog* instance;
+  ConnectTimingLog() {}  // Private constructor to enforce singleton
+
+  std::mutex mutex;
+  std::vector<ConnectTiming> timings;
+  size_t next = 0;
+};
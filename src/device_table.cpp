@@ -0,0 +1,68 @@
+#include "device_table.h"
+#include <cstring>
+#include <algorithm>
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   DeviceTable methods    ----------------------------------
+// ---------------------------------------------------------------------------------------
+
+DeviceTable::DeviceTable(size_t capacity, uint32_t expiryMs) : entries(capacity), expiryMs(expiryMs) {
+  clear();
+}
+
+DeviceTableEntry* DeviceTable::find(const uint8_t* address) {
+  for (auto& entry : entries) {
+    if (entry.used && memcmp(entry.address, address, sizeof(entry.address)) == 0) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+DeviceTableEntry* DeviceTable::insert(const uint8_t* address, int rssi, uint32_t now) {
+  DeviceTableEntry* slot = nullptr;
+  for (auto& entry : entries) {
+    if (!entry.used) {
+      slot = &entry;
+      break;
+    }
+    // Matched scales are never evicted, they only go away by expiring.
+    if (entry.match != MatchResult::MATCHED && (slot == nullptr || now - entry.lastSeen > now - slot->lastSeen)) {
+      slot = &entry;
+    }
+  }
+  if (slot == nullptr) {
+    return nullptr;
+  }
+
+  memcpy(slot->address, address, sizeof(slot->address));
+  slot->match = MatchResult::UNKNOWN;
+  slot->used = true;
+  slot->smoothedRssiQ4 = static_cast<int16_t>(rssi * 16);
+  slot->firstSeen = now;
+  slot->lastSeen = now;
+  slot->name[0] = '\0';
+  return slot;
+}
+
+void DeviceTable::touch(DeviceTableEntry& entry, int rssi, uint32_t now) {
+  // Exponential moving average with alpha = 1/4, enough to ride out the usual +-10dB fading.
+  entry.smoothedRssiQ4 += static_cast<int16_t>((rssi * 16 - entry.smoothedRssiQ4) / 4);
+  entry.lastSeen = now;
+}
+
+void DeviceTable::setName(DeviceTableEntry& entry, const std::string& name) {
+  size_t length = std::min(name.size(), DeviceTableEntry::MAX_NAME_LENGTH);
+  memcpy(entry.name, name.data(), length);
+  entry.name[length] = '\0';
+}
+
+void DeviceTable::clear() {
+  for (auto& entry : entries) {
+    entry.used = false;
+  }
+}
+
+size_t DeviceTable::size() const {
+  return std::count_if(entries.begin(), entries.end(), [](const DeviceTableEntry& entry) { return entry.used; });
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+enum class MatchResult : uint8_t {
+  UNKNOWN,                  // Not run through the plugin registry yet.
+  MATCHED,                  // One of the registered plugins handles this device.
+  NOT_MATCHED,              // No plugin handles this device.
+  AWAITING_SCAN_RESPONSE,   // Can't tell until its scan response (and name) arrives.
+};
+
+struct DeviceTableEntry {
+  static constexpr size_t MAX_NAME_LENGTH = 29; // Longest name that fits in a legacy advert
+
+  uint8_t address[6];
+  MatchResult match;
+  bool used;
+  int16_t smoothedRssiQ4; // RSSI in dBm * 16
+  uint32_t firstSeen;
+  uint32_t lastSeen;
+  char name[MAX_NAME_LENGTH + 1];
+
+  int getRssi() const { return smoothedRssiQ4 / 16; }
+};
+
+// Fixed size table of every advertiser the scanner has heard, keyed by address.
+// All entries are allocated up front so memory use doesn't depend on how crowded the RF environment is.
+// When the table is full the least recently seen entry that isn't a matched scale makes room.
+// Not thread safe, the scanner guards it.
+class DeviceTable {
+public:
+  DeviceTable(size_t capacity, uint32_t expiryMs);
+
+  DeviceTableEntry* find(const uint8_t* address);
+  // Returns nullptr if the table is full of matched scales.
+  DeviceTableEntry* insert(const uint8_t* address, int rssi, uint32_t now);
+  void touch(DeviceTableEntry& entry, int rssi, uint32_t now);
+  void setName(DeviceTableEntry& entry, const std::string& name);
+
+  // Entries that weren't seen for expiryMs are dropped. onExpired is called for each of them before.
+  template<typename Callback>
+  void expire(uint32_t now, Callback onExpired) {
+    if (expiryMs == 0) return;
+    for (auto& entry : entries) {
+      if (entry.used && now - entry.lastSeen >= expiryMs) {
+        onExpired(entry);
+        entry.used = false;
+      }
+    }
+  }
+
+  void clear();
+  void setExpiry(uint32_t expiryMs) { this->expiryMs = expiryMs; }
+  uint32_t getExpiry() const { return expiryMs; }
+  size_t size() const;
+  size_t capacity() const { return entries.size(); }
+
+private:
+  std::vector<DeviceTableEntry> entries;
+  uint32_t expiryMs;
+};
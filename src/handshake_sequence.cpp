@@ -0,0 +1,134 @@
+#include "handshake_sequence.h"
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   HandshakeSequence    ------------------------------------
+// ---------------------------------------------------------------------------------------
+
+void HandshakeSequence::addAction(const char* name, std::function<bool()> action) {
+  std::lock_guard<std::mutex> lock(mutex);
+  steps.push_back(Step{ name, StepType::ACTION, action, nullptr, 0 });
+}
+
+void HandshakeSequence::addNotificationWait(const char* name, NotificationMatcher matches, uint32_t timeoutMs) {
+  std::lock_guard<std::mutex> lock(mutex);
+  steps.push_back(Step{ name, StepType::NOTIFICATION, nullptr, matches, timeoutMs });
+}
+
+void HandshakeSequence::addDelay(const char* name, uint32_t delayMs) {
+  std::lock_guard<std::mutex> lock(mutex);
+  steps.push_back(Step{ name, StepType::DELAY, nullptr, nullptr, delayMs });
+}
+
+void HandshakeSequence::start() {
+  std::lock_guard<std::mutex> lock(mutex);
+  generation++;
+  listeningStep.reset();
+  state = State::RUNNING;
+  enterStep(0);
+}
+
+void HandshakeSequence::cancel() {
+  std::lock_guard<std::mutex> lock(mutex);
+  generation++;
+  listeningStep.reset();
+  if (state == State::RUNNING) {
+    state = State::IDLE;
+  }
+}
+
+HandshakeSequence::State HandshakeSequence::run(uint32_t sliceMs) {
+  uint32_t startedAt = millis();
+  bool ranAction = false;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (state == State::RUNNING) {
+    if (current >= steps.size()) {
+      listeningStep.reset();
+      state = State::DONE;
+      break;
+    }
+
+    const Step& step = steps[current];
+    uint32_t elapsedMs = millis() - stepStartedAt;
+    if (step.type == StepType::NOTIFICATION) {
+      if (!notified) {
+        if (elapsedMs >= step.durationMs) {
+          listeningStep.reset();
+          state = State::FAILED;
+        }
+        break;
+      }
+    }
+    else if (step.type == StepType::DELAY) {
+      if (elapsedMs < step.durationMs) {
+        break;
+      }
+    }
+    else {
+      if (ranAction && millis() - startedAt >= sliceMs) {
+        break; // The other scales get their turn, getMillisUntilDeadline() is 0
+      }
+      // Actions block on the link, the lock is only held while the step changes.
+      uint32_t startedGeneration = generation;
+      std::function<bool()> action = step.action;
+      lock.unlock();
+      bool succeeded = action();
+      lock.lock();
+      ranAction = true;
+      if (generation != startedGeneration) {
+        break; // Cancelled or started again meanwhile
+      }
+      if (!succeeded) {
+        listeningStep.reset();
+        state = State::FAILED;
+        break;
+      }
+    }
+    enterStep(current + 1);
+  }
+  return state;
+}
+
+bool HandshakeSequence::onNotification(const uint8_t* data, size_t length) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!listeningStep || notified || !steps[*listeningStep].matches(data, length)) {
+    return false;
+  }
+  notified = true;
+  return true;
+}
+
+const char* HandshakeSequence::getStepName() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return current < steps.size() ? steps[current].name : "done";
+}
+
+std::optional<uint32_t> HandshakeSequence::getMillisUntilDeadline() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (state != State::RUNNING) {
+    return std::nullopt;
+  }
+  if (current >= steps.size() || steps[current].type == StepType::ACTION
+    || (steps[current].type == StepType::NOTIFICATION && notified)) {
+    return 0;
+  }
+  uint32_t elapsedMs = millis() - stepStartedAt;
+  return elapsedMs < steps[current].durationMs ? steps[current].durationMs - elapsedMs : 0;
+}
+
+// With the mutex held.
+void HandshakeSequence::enterStep(size_t index) {
+  current = index;
+  stepStartedAt = millis();
+
+  std::optional<size_t> listening;
+  if (index < steps.size() && steps[index].type == StepType::NOTIFICATION) {
+    listening = index;
+  }
+  else if (index + 1 < steps.size() && steps[index + 1].type == StepType::NOTIFICATION) {
+    listening = index + 1;
+  }
+  if (listening != listeningStep) {
+    listeningStep = listening;
+    notified = false;
+  }
+}
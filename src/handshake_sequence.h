@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <vector>
+
+// A connection handshake as a list of steps, run a slice at a time from the scales' update() instead of
+// blocking connect() until the scale streams. A step runs an action once, waits for a notification from
+// the scale, or waits out a delay. Scales updated from the same task take turns at their handshakes, so
+// several of them handshake at once and the waits overlap. An action doing a GATT procedure still blocks
+// for its round trip, NimBLE 1.4 has no other way.
+class HandshakeSequence {
+public:
+  enum class State : uint8_t { IDLE, RUNNING, DONE, FAILED };
+  using NotificationMatcher = std::function<bool(const uint8_t* data, size_t length)>;
+
+  // Steps are added once, i.e. in the driver's constructor, and run again by every start().
+  // An action returning false fails the handshake.
+  void addAction(const char* name, std::function<bool()> action);
+  // Waits for a notification the matcher accepts, failing the handshake after timeoutMs. Notifications
+  // count from the start of the step before, so the reply to that step's write isn't missed.
+  void addNotificationWait(const char* name, NotificationMatcher matches, uint32_t timeoutMs);
+  void addDelay(const char* name, uint32_t delayMs);
+
+  void start();
+  void cancel();
+  // Runs steps until one waits, the handshake ends or sliceMs are used up, at least one step if it can.
+  State run(uint32_t sliceMs);
+  // For every notification, from the BLE host task. True if it was the one a step is waiting for.
+  bool onNotification(const uint8_t* data, size_t length);
+
+  State getState() const { return state; }
+  // The step running, or the one that failed.
+  const char* getStepName();
+  // How long until run() has something to do without a notification: 0 when the slice ran out, the rest
+  // of the delay or timeout when a step waits. Nothing when the handshake isn't running.
+  std::optional<uint32_t> getMillisUntilDeadline();
+
+private:
+  enum class StepType : uint8_t { ACTION, NOTIFICATION, DELAY };
+  struct Step {
+    const char* name;
+    StepType type;
+    std::function<bool()> action;
+    NotificationMatcher matches;
+    uint32_t durationMs;  // The timeout of a notification wait or the length of a delay
+  };
+
+  std::mutex mutex;
+  std::vector<Step> steps;
+  std::atomic<State> state{ State::IDLE };
+  uint32_t generation = 0;  // Changed by start() and cancel(), so an action that outlived its run is ignored
+  size_t current = 0;
+  uint32_t stepStartedAt = 0;
+  std::optional<size_t> listeningStep;  // The notification wait that onNotification() feeds
+  bool notified = false;
+
+  void enterStep(size_t index);
+};
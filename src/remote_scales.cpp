@@ -1,5 +1,12 @@
 #include "remote_scales.h"
 #include "remote_scales_plugin_registry.h"
+#include "remote_scales_task.h"
+#include "remote_scales_client_pool.h"
+#include <algorithm>
+#include <optional>
+
+std::mutex RemoteScales::learnedTolerancesMutex;
+std::vector<RemoteScales::LearnedTolerance> RemoteScales::learnedTolerances;
 
 // ---------------------------------------------------------------------------------------
 // ------------------------   Common RemoteScales methods    ------------------------------
@@ -22,17 +29,85 @@ void RemoteScales::log(std::string msgFormat, ...) {
   logCallback("Scale[" + device.getName() + "] " + formattedMessage);
 }
 
-void RemoteScales::setWeight(float newWeight) {
-  float previousWeight = weight;
-  weight = newWeight;
+void RemoteScales::setWeightMilligrams(int32_t rawWeightMg) {
+  if (connectTimingActive) {
+    markConnectPhase(ConnectPhase::FIRST_WEIGHT);
+    finishConnectTiming(true);
+    armWatchdog();
+  }
+  lastTrafficAt = millis();
+  if (watchdogStage == WatchdogStage::RESUBSCRIBED) {
+    std::lock_guard<std::mutex> lock(watchdogMutex);
+    watchdogStage = WatchdogStage::WATCHING;
+    stallStats.resubscribed++;
+    stallStats.lastRecoveryMs = lastTrafficAt - watchdogSince;
+  }
+  updatePendingTare(rawWeightMg);
 
-  if (weightCallback == nullptr) {
-    return;
+  uint32_t now = millis();
+  int32_t previousWeightMg;
+  int32_t newWeightMg;
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    previousWeightMg = snapshotDraft.weightMg;
+    newWeightMg = applyTareOffset(rawWeightMg, previousWeightMg);
+    uint32_t elapsedMs = now - snapshotDraft.timestamp;
+    if (snapshotDraft.timestamp != 0 && elapsedMs > 0) {
+      int32_t flow = static_cast<int32_t>(static_cast<int64_t>(newWeightMg - previousWeightMg) * 1000 / elapsedMs);
+      snapshotDraft.flowMgPerSecond += (flow - snapshotDraft.flowMgPerSecond) / 4;
+    }
+    if (snapshotDraft.timestamp != 0 && elapsedMs < 5000) {
+      int32_t intervalQ4 = sampleIntervalQ4;
+      intervalQ4 = intervalQ4 == 0 ? elapsedMs << 4 : intervalQ4 + ((static_cast<int32_t>(elapsedMs << 4) - intervalQ4) / 8);
+      sampleIntervalQ4 = intervalQ4;
+    }
+    snapshotDraft.weightMg = newWeightMg;
+    snapshotDraft.timestamp = now;
+    snapshot.store(snapshotDraft);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sampleListenersMutex);
+    WeightSample sample{ .weightMg = newWeightMg, .timestamp = now };
+    for (const auto& listener : sampleListeners) {
+      listener.second(sample);
+    }
   }
-  if (weightCallbackOnlyChanges && previousWeight == newWeight) {
+
+  bool changed = previousWeightMg != newWeightMg;
+  bool notifyGrams = weightCallback != nullptr && (changed || !weightCallbackOnlyChanges);
+  bool notifyMilligrams = weightMilligramsCallback != nullptr && (changed || !weightMilligramsCallbackOnlyChanges);
+  if (!notifyGrams && !notifyMilligrams) {
     return;
   }
-  weightCallback(newWeight);
+  if (callbackExecutor == CallbackExecutor::INLINE) {
+    dispatchWeight(newWeightMg, changed);
+  }
+  else {
+    queueCallback(QueuedCallback{ .kind = QueuedCallback::Kind::WEIGHT, .weightMg = newWeightMg, .weightChanged = changed });
+  }
+}
+
+void RemoteScales::resetWeight() {
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    lastRawWeightMg = 0;
+    snapshotDraft.weightMg = 0;
+    // The next sample starts flow and sample rate estimation over instead of measuring across the reconnect.
+    snapshotDraft.timestamp = 0;
+    snapshotDraft.flowMgPerSecond = 0;
+    snapshot.store(snapshotDraft);
+  }
+  lastTrafficAt = 0;
+}
+
+void RemoteScales::dispatchWeight(int32_t weightMg, bool changed) {
+  if (weightMilligramsCallback != nullptr && (changed || !weightMilligramsCallbackOnlyChanges)) {
+    weightMilligramsCallback(weightMg);
+  }
+  if (weightCallback != nullptr && (changed || !weightCallbackOnlyChanges)) {
+    weightCallback(weightMg / 1000.f);
+  }
 }
 
 void RemoteScales::setWeightUpdatedCallback(void (*callback)(float), bool onlyChanges) {
@@ -40,22 +115,770 @@ void RemoteScales::setWeightUpdatedCallback(void (*callback)(float), bool onlyCh
   this->weightCallback = callback;
 }
 
+void RemoteScales::setWeightMilligramsUpdatedCallback(void (*callback)(int32_t), bool onlyChanges) {
+  weightMilligramsCallbackOnlyChanges = onlyChanges;
+  this->weightMilligramsCallback = callback;
+}
+
+void RemoteScales::setBattery(uint8_t batteryPercent) {
+  if (status.batteryPercent == batteryPercent) return;
+  status.batteryPercent = batteryPercent;
+  notifyStatusChanged(ScaleStatus::BATTERY);
+}
+
+void RemoteScales::setWeightUnit(WeightUnit units) {
+  if (status.units == units) return;
+  status.units = units;
+  notifyStatusChanged(ScaleStatus::UNITS);
+}
+
+void RemoteScales::setTimer(TimerState timerState, uint32_t timerMs) {
+  if (status.timerState == timerState && status.timerMs == timerMs) return;
+  status.timerState = timerState;
+  status.timerMs = timerMs;
+  notifyStatusChanged(ScaleStatus::TIMER);
+}
+
+void RemoteScales::setDecimals(uint8_t decimals) {
+  if (status.decimals == decimals) return;
+  status.decimals = decimals;
+  notifyStatusChanged(ScaleStatus::DECIMALS);
+}
+
+void RemoteScales::setConnected(bool connected) {
+  std::lock_guard<std::mutex> lock(snapshotMutex);
+  if (snapshotDraft.connected == connected) {
+    return;
+  }
+  snapshotDraft.connected = connected;
+  sampleIntervalQ4 = 0;
+  snapshot.store(snapshotDraft);
+}
+
+void RemoteScales::notifyStatusChanged(uint8_t changedFields) {
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    snapshotDraft.status = status;
+    snapshot.store(snapshotDraft);
+  }
+  if (statusCallback == nullptr) {
+    return;
+  }
+  if (callbackExecutor == CallbackExecutor::INLINE) {
+    statusCallback(status, changedFields);
+  }
+  else {
+    queueCallback(QueuedCallback{ .kind = QueuedCallback::Kind::STATUS, .changedFields = changedFields, .status = status });
+  }
+}
+
+// When the queue is full callbacks are dropped and counted.
+void RemoteScales::queueCallback(const QueuedCallback& callback) {
+  bool queued;
+  {
+    std::lock_guard<std::mutex> lock(callbackQueueMutex);
+    queued = callbackQueue.push(callback);
+  }
+  if (queued && callbackExecutor == CallbackExecutor::SCALE_TASK) {
+    requestUpdate();
+  }
+}
+
+size_t RemoteScales::runCallbacks() {
+  size_t count = 0;
+  QueuedCallback callback;
+  while (callbackQueue.pop(callback)) {
+    switch (callback.kind) {
+    case QueuedCallback::Kind::WEIGHT:
+      dispatchWeight(callback.weightMg, callback.weightChanged);
+      break;
+    case QueuedCallback::Kind::STATUS:
+      if (statusCallback != nullptr) {
+        statusCallback(callback.status, callback.changedFields);
+      }
+      break;
+    case QueuedCallback::Kind::CONNECTION_STATE:
+      if (connectionCallback != nullptr) {
+        connectionCallback(callback.connectionState);
+      }
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
+void RemoteScales::requestUpdate() {
+  RemoteScalesTask* currentTask = task;
+  if (currentTask != nullptr) {
+    currentTask->wake();
+  }
+}
+
+void RemoteScales::requestReconnect() {
+  restartDue = true;
+  requestUpdate();
+}
+
+void RemoteScales::setStreamingProfile(StreamingProfile profile) {
+  if (streamingProfile.exchange(profile) != profile && clientIsConnected()) {
+    applyStreamingProfile(profile);
+  }
+}
+
+float RemoteScales::getSampleRate() const {
+  uint32_t intervalQ4 = sampleIntervalQ4;
+  return intervalQ4 > 0 ? 16000.f / intervalQ4 : 0.f;
+}
+
+TareHandle RemoteScales::tareAsync(uint32_t timeoutMs) {
+  auto operation = std::make_shared<TareOperation>();
+  operation->startedAt = millis();
+  {
+    // A new tare supersedes the previous one.
+    std::lock_guard<std::mutex> lock(tareMutex);
+    if (pendingTare != nullptr) {
+      pendingTare->state = TareState::SUPERSEDED;
+      tareStats.superseded++;
+    }
+    pendingTare = operation;
+  }
+
+  RemoteScalesTimerWheel::getInstance()->schedule(this, ScaleTimer::TARE, timeoutMs);
+  requestUpdate();
+  if (!tare()) {
+    completeTare(TareState::FAILED);
+    return operation;
+  }
+  {
+    std::lock_guard<std::mutex> lock(tareMutex);
+    if (pendingTare == operation) {
+      operation->commandSent = true;
+      operation->commandSentAt = millis();
+      operation->samplesNearZero = 0;
+    }
+  }
+  return operation;
+}
+
+TareHandle RemoteScales::tareHybrid(uint32_t timeoutMs) {
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    tareOffsetMg = lastRawWeightMg;
+    tareOffsetState = TareOffsetState::AWAITING_SCALE;
+    // Readers see the zero right away, callbacks and listeners with the next sample.
+    snapshotDraft.weightMg = 0;
+    snapshot.store(snapshotDraft);
+  }
+  return tareAsync(timeoutMs);
+}
+
+// Called with snapshotMutex held.
+int32_t RemoteScales::applyTareOffset(int32_t rawWeightMg, int32_t previousWeightMg) {
+  lastRawWeightMg = rawWeightMg;
+  if (tareOffsetState == TareOffsetState::AWAITING_SCALE) {
+    // Once the scale applied the tare, its raw reading continues the published weight better than
+    // the offset reading does. Whatever difference is left between both zeros is blended out.
+    if (abs(rawWeightMg - previousWeightMg) < abs(rawWeightMg - tareOffsetMg - previousWeightMg)) {
+      tareOffsetMg = rawWeightMg - previousWeightMg;
+      tareOffsetState = TareOffsetState::BLENDING;
+    }
+  }
+  else if (tareOffsetState == TareOffsetState::BLENDING) {
+    tareOffsetMg -= tareOffsetMg / 4;
+    if (abs(tareOffsetMg) < 4) {
+      tareOffsetMg = 0;
+      tareOffsetState = TareOffsetState::NONE;
+    }
+  }
+  return rawWeightMg - tareOffsetMg;
+}
+
+TareStats RemoteScales::getTareStats() {
+  std::lock_guard<std::mutex> lock(tareMutex);
+  return tareStats;
+}
+
+void RemoteScales::confirmTare() {
+  completeTare(TareState::CONFIRMED);
+}
+
+// Only samples that arrive after the command went out count. Samples that were on their way when
+// the tare was sent still show the old weight, so it takes a couple of them in a row near zero to be
+// sure the tare was applied.
+void RemoteScales::updatePendingTare(int32_t weightMg) {
+  static constexpr uint8_t SETTLED_SAMPLES = 2;
+  {
+    std::lock_guard<std::mutex> lock(tareMutex);
+    if (pendingTare == nullptr || !pendingTare->commandSent) {
+      return;
+    }
+    if (static_cast<int32_t>(millis() - pendingTare->commandSentAt) <= 0) {
+      return;
+    }
+    if (abs(weightMg) > tareToleranceMg) {
+      pendingTare->samplesNearZero = 0;
+      return;
+    }
+    if (++pendingTare->samplesNearZero < SETTLED_SAMPLES) {
+      return;
+    }
+  }
+  completeTare(TareState::CONFIRMED);
+}
+
+void RemoteScales::completeTare(TareState state) {
+  std::shared_ptr<TareOperation> operation;
+  {
+    std::lock_guard<std::mutex> lock(tareMutex);
+    operation.swap(pendingTare);
+    if (operation == nullptr) {
+      return;
+    }
+
+    if (state == TareState::CONFIRMED) {
+      uint32_t latencyMs = millis() - operation->startedAt;
+      operation->latencyMs = latencyMs;
+      tareStats.confirmed++;
+      tareStats.lastLatencyMs = latencyMs;
+      tareStats.maxLatencyMs = std::max(tareStats.maxLatencyMs, latencyMs);
+      tareStats.totalLatencyMs += latencyMs;
+    }
+    else if (state == TareState::TIMED_OUT) {
+      tareStats.timedOut++;
+    }
+    else {
+      tareStats.failed++;
+    }
+    operation->state = state;
+  }
+  if (state != TareState::TIMED_OUT) {
+    RemoteScalesTimerWheel::getInstance()->cancel(this, ScaleTimer::TARE);
+  }
+  if (state != TareState::CONFIRMED) {
+    // The scale didn't tare, so a software zero would hide its real reading.
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    if (tareOffsetState == TareOffsetState::AWAITING_SCALE) {
+      tareOffsetMg = 0;
+      tareOffsetState = TareOffsetState::NONE;
+    }
+  }
+}
+
+void RemoteScales::handleTimer(ScaleTimer timer) {
+  if (timer == ScaleTimer::TARE) {
+    completeTare(TareState::TIMED_OUT);
+  }
+  else if (timer == ScaleTimer::RECONNECT) {
+    // Only marked here, connecting inside the shared timer wheel would hold up every other scale's timers.
+    reconnectDue = true;
+    requestUpdate();
+  }
+  else if (timer == ScaleTimer::WATCHDOG) {
+    checkDataStall();
+  }
+  else if (timer == ScaleTimer::HANDSHAKE) {
+    return; // Only wakes update(), runTimers() runs the handshake after the timers
+  }
+  else if (timer != ScaleTimer::HEARTBEAT || shouldSendHeartbeat()) {
+    onTimer(timer);
+  }
+}
+
+KeepaliveStats RemoteScales::getKeepaliveStats() {
+  std::lock_guard<std::mutex> lock(keepaliveMutex);
+  return keepaliveStats;
+}
+
+// While notifications keep arriving the heartbeat gap is stretched one interval at a time, up to
+// getMaxHeartbeatGap(). If the notifications stop after a stretched gap, the scale doesn't tolerate
+// that much silence: the gap at which it stopped is remembered and stretching stays below it.
+bool RemoteScales::shouldSendHeartbeat() {
+  uint32_t now = millis();
+  uint32_t intervalMs = getTimerInterval(ScaleTimer::HEARTBEAT);
+  uint32_t maxGapMs = getMaxHeartbeatGap(intervalMs);
+  uint32_t trafficAt = lastTrafficAt;
+  std::lock_guard<std::mutex> lock(keepaliveMutex);
+  keepaliveStats.allowedGapMs = std::min(std::max(keepaliveStats.allowedGapMs, intervalMs), maxGapMs);
+
+  bool flowing = trafficAt != 0 && now - trafficAt < intervalMs;
+  if (keepalivePolicy == KeepalivePolicy::ADAPTIVE && flowing && now - lastHeartbeatAt + intervalMs <= keepaliveStats.allowedGapMs) {
+    keepaliveStats.skipped++;
+    return false;
+  }
+
+  if (!flowing) {
+    learnSilenceTolerance(trafficAt, intervalMs);
+  }
+  else if (keepalivePolicy == KeepalivePolicy::ADAPTIVE && keepaliveStats.allowedGapMs + intervalMs <= maxGapMs
+    && (keepaliveStats.silenceToleranceMs == 0 || keepaliveStats.allowedGapMs + intervalMs < keepaliveStats.silenceToleranceMs)) {
+    keepaliveStats.allowedGapMs += intervalMs;
+  }
+  keepaliveStats.sent++;
+  lastHeartbeatAt = now;
+  return true;
+}
+
+// Called with keepaliveMutex held once the scale went quiet: at a heartbeat, by the watchdog or on a lost link.
+// If its last notification came more than an interval after the last heartbeat, a heartbeat was skipped and the
+// scale may have stopped because of it.
+void RemoteScales::learnSilenceTolerance(uint32_t trafficAt, uint32_t intervalMs) {
+  // Only traffic after the last heartbeat tells how long the scale kept notifying without one.
+  bool notifiedSinceHeartbeat = trafficAt != 0 && static_cast<int32_t>(trafficAt - lastHeartbeatAt) > 0;
+  if (keepalivePolicy != KeepalivePolicy::ADAPTIVE || intervalMs == 0 || !notifiedSinceHeartbeat) {
+    return;
+  }
+  uint32_t silentGapMs = std::min(trafficAt - lastHeartbeatAt, intervalMs * MAX_HEARTBEAT_GAP_FACTOR);
+  if (silentGapMs <= intervalMs || (keepaliveStats.silenceToleranceMs != 0 && keepaliveStats.silenceToleranceMs <= silentGapMs)) {
+    return;
+  }
+
+  keepaliveStats.silenceToleranceMs = silentGapMs;
+  keepaliveStats.allowedGapMs = std::max(intervalMs, silentGapMs - intervalMs);
+  log("Notifications stopped %ums after the last heartbeat, heartbeats at most every %ums from now on\n",
+    silentGapMs, keepaliveStats.allowedGapMs);
+
+  std::lock_guard<std::mutex> lock(learnedTolerancesMutex);
+  auto it = std::find_if(learnedTolerances.begin(), learnedTolerances.end(),
+    [&](const LearnedTolerance& learned) { return learned.address == device.getAddress(); });
+  if (it != learnedTolerances.end()) {
+    it->silenceToleranceMs = silentGapMs;
+    return;
+  }
+  if (learnedTolerances.size() >= LEARNED_TOLERANCE_CAPACITY) {
+    learnedTolerances.erase(learnedTolerances.begin());
+  }
+  learnedTolerances.push_back(LearnedTolerance{ device.getAddress(), silentGapMs });
+}
+
+// Stretching stops below the watchdog window too, or the watchdog would take the silence of a scale that
+// wants its heartbeat for a stall before the heartbeat timer sees it.
+uint32_t RemoteScales::getMaxHeartbeatGap(uint32_t intervalMs) {
+  uint32_t maxGapMs = intervalMs * MAX_HEARTBEAT_GAP_FACTOR;
+  uint32_t windowMs = getTimerInterval(ScaleTimer::WATCHDOG);
+  if (windowMs != 0) {
+    maxGapMs = std::min(maxGapMs, windowMs - 1);
+  }
+  return std::max(intervalMs, maxGapMs);
+}
+
+// A new connection stretches from one interval again, below what was learned about this scale before.
+void RemoteScales::restoreKeepalive() {
+  std::optional<uint32_t> learnedMs;
+  {
+    std::lock_guard<std::mutex> lock(learnedTolerancesMutex);
+    for (const auto& learned : learnedTolerances) {
+      if (learned.address == device.getAddress()) {
+        learnedMs = learned.silenceToleranceMs;
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(keepaliveMutex);
+  keepaliveStats.allowedGapMs = 0;
+  if (learnedMs) {
+    keepaliveStats.silenceToleranceMs = *learnedMs;
+  }
+}
+
+size_t RemoteScales::addSampleListener(SampleListener listener) {
+  std::lock_guard<std::mutex> lock(sampleListenersMutex);
+  sampleListeners.emplace_back(nextSampleListenerId, listener);
+  return nextSampleListenerId++;
+}
+
+void RemoteScales::removeSampleListener(size_t listenerId) {
+  std::lock_guard<std::mutex> lock(sampleListenersMutex);
+  sampleListeners.erase(
+    std::remove_if(sampleListeners.begin(), sampleListeners.end(), [=](const auto& listener) { return listener.first == listenerId; }),
+    sampleListeners.end()
+  );
+}
+
+void RemoteScales::setTimerInterval(ScaleTimer timer, uint32_t intervalMs) {
+  size_t index = static_cast<size_t>(timer);
+  timerIntervals[index] = intervalMs;
+  if (timerPeriodic[index] && RemoteScalesTimerWheel::getInstance()->isScheduled(this, timer)) {
+    startTimer(timer);
+  }
+}
+
+void RemoteScales::startTimer(ScaleTimer timer, bool periodic) {
+  size_t index = static_cast<size_t>(timer);
+  uint32_t intervalMs = timerIntervals[index];
+  if (intervalMs == 0) {
+    return; // The driver doesn't use this timer
+  }
+  timerPeriodic[index] = periodic;
+  if (timer == ScaleTimer::HEARTBEAT) {
+    // The handshake that comes before counts as a heartbeat.
+    std::lock_guard<std::mutex> lock(keepaliveMutex);
+    lastHeartbeatAt = millis();
+  }
+  RemoteScalesTimerWheel::getInstance()->schedule(this, timer, intervalMs, periodic ? intervalMs : 0);
+  requestUpdate(); // The scale task may be sleeping past the new deadline
+}
+
+void RemoteScales::stopTimer(ScaleTimer timer) {
+  RemoteScalesTimerWheel::getInstance()->cancel(this, timer);
+}
+
 bool RemoteScales::clientConnect() {
   clientCleanup();
+  beginConnectTiming();
   log("Connecting to BLE client\n");
-  client = NimBLEDevice::createClient(device.getAddress());
-  return client->connect();
+  bool keepAttributes = false;
+  client = RemoteScalesClientPool::getInstance()->acquire(device.getAddress(), keepAttributes);
+  if (client == nullptr) {
+    log("No BLE client available\n");
+    finishConnectTiming(false);
+    return false;
+  }
+  client->setClientCallbacks(&clientCallbacks, false);
+  restoreKeepalive();
+  if (linkProfile.minInterval != 0) {
+    client->setConnectionParams(linkProfile.minInterval, linkProfile.maxInterval, linkProfile.latency, linkProfile.supervisionTimeout);
+  }
+  if (linkProfile.mtu > NimBLEDevice::getMTU()) {
+    // NimBLE only has a global preferred MTU, it is exchanged right after connecting.
+    NimBLEDevice::setMTU(linkProfile.mtu);
+  }
+  // The services of the same scales are still valid, drivers find them without discovering again.
+  bool connected = client->connect(!keepAttributes);
+  setConnected(connected);
+  if (connected) {
+    markConnectPhase(ConnectPhase::CLIENT_CONNECT);
+    setConnectionState(ConnectionState::CONNECTED);
+    applyLinkProfile();
+  }
+  else {
+    finishConnectTiming(false);
+  }
+  return connected;
+}
+
+// Some scales pick their own interval when connecting, ask once more for ours.
+void RemoteScales::applyLinkProfile() {
+  LinkParameters parameters = getLinkParameters();
+  if (linkProfile.minInterval != 0 && parameters.interval > linkProfile.maxInterval) {
+    log("Connection interval %.2fms is longer than requested, asking for an update\n", parameters.getIntervalMs());
+    client->updateConnParams(linkProfile.minInterval, linkProfile.maxInterval, linkProfile.latency, linkProfile.supervisionTimeout);
+  }
+  log("Connected with interval %.2fms, latency %d, timeout %dms, MTU %d\n",
+    parameters.getIntervalMs(), parameters.latency, parameters.supervisionTimeout * 10, parameters.mtu);
+}
+
+LinkParameters RemoteScales::getLinkParameters() {
+  LinkParameters parameters;
+  if (!clientIsConnected()) {
+    return parameters;
+  }
+  NimBLEConnInfo info = client->getConnInfo();
+  parameters.interval = info.getConnInterval();
+  parameters.latency = info.getConnLatency();
+  parameters.supervisionTimeout = info.getConnTimeout();
+  parameters.mtu = client->getMTU();
+  return parameters;
 }
 
 void RemoteScales::clientCleanup() {
+  handshake.cancel();
+  RemoteScalesTimerWheel::getInstance()->cancelAll(this);
+  completeTare(TareState::FAILED);
+  finishConnectTiming(false);
+  setConnected(false);
+  // A deliberate disconnect stops reconnecting, a failed attempt of reconnect() doesn't.
+  setConnectionState(reconnectInProgress ? ConnectionState::RECONNECTING : ConnectionState::DISCONNECTED);
+  {
+    // A pending batch belongs to the connection that is going away.
+    std::lock_guard<std::recursive_mutex> lock(writeMutex);
+    batchBuffer.clear();
+    batchCharacteristic = nullptr;
+  }
   if (client == nullptr) {
     return;
   }
   log("Cleaning up BLE client\n");
-  NimBLEDevice::deleteClient(client);
+  RemoteScalesClientPool::getInstance()->release(client);
   client = nullptr;
 }
 
+// ---------------------------------------------------------------------------------------
+// ------------------------   Connection state and reconnects    -------------------------
+// ---------------------------------------------------------------------------------------
+
+void RemoteScales::setConnectionState(ConnectionState state) {
+  if (connectionState.exchange(state) != state) {
+    publishConnectionState(state);
+  }
+}
+
+void RemoteScales::publishConnectionState(ConnectionState state) {
+  if (connectionCallback == nullptr) {
+    return;
+  }
+  if (callbackExecutor == CallbackExecutor::INLINE) {
+    connectionCallback(state);
+  }
+  else {
+    queueCallback(QueuedCallback{ .kind = QueuedCallback::Kind::CONNECTION_STATE, .connectionState = state });
+  }
+}
+
+// Runs on the BLE host task. The client is only released later, by clientConnect() or the driver,
+// because releasing it waits for NimBLE, which would block its own callbacks. For the same reason the
+// timers are only unscheduled here: waiting for one that is firing is left to runTimers().
+void RemoteScales::handleLinkLost() {
+  ConnectionState expected = ConnectionState::CONNECTED;
+  ConnectionState next = reconnectPolicy.enabled ? ConnectionState::RECONNECTING : ConnectionState::DISCONNECTED;
+  if (!connectionState.compare_exchange_strong(expected, next)) {
+    return; // Disconnected on purpose, or while a reconnect attempt was still setting up
+  }
+  log("Connection to %s lost\n", device.getName().c_str());
+  handshake.cancel();
+  {
+    // The scale may have dropped the link because a heartbeat was skipped.
+    std::lock_guard<std::mutex> lock(keepaliveMutex);
+    learnSilenceTolerance(lastTrafficAt, getTimerInterval(ScaleTimer::HEARTBEAT));
+  }
+  for (size_t i = 0; i < SCALE_TIMER_COUNT; i++) {
+    RemoteScalesTimerWheel::getInstance()->cancel(this, static_cast<ScaleTimer>(i));
+  }
+  completeTare(TareState::FAILED);
+  finishConnectTiming(false);
+  setConnected(false);
+  publishConnectionState(next);
+  linkLost = true;
+  requestUpdate();
+}
+
+void RemoteScales::runTimers() {
+  if (linkLost.exchange(false)) {
+    RemoteScalesTimerWheel::getInstance()->cancelAll(this);
+    if (connectionState == ConnectionState::RECONNECTING) {
+      reconnectAttempts = 0;
+      scheduleReconnect();
+    }
+  }
+  RemoteScalesTimerWheel::getInstance()->update(this);
+  if (resubscribeDue.exchange(false) && connectionState == ConnectionState::CONNECTED) {
+    resubscribeAfterStall();
+  }
+  // Either may be stale by now, i.e. after a deliberate disconnect.
+  bool restart = restartDue.exchange(false);
+  bool reconnectNow = reconnectDue.exchange(false);
+  if (restart && connectionState == ConnectionState::CONNECTED) {
+    restartConnection();
+  }
+  else if (reconnectNow && connectionState == ConnectionState::RECONNECTING) {
+    reconnect();
+  }
+
+  if (isHandshaking() && connectionState == ConnectionState::CONNECTED && !runHandshake()) {
+    bool retry = reconnectPolicy.enabled && (reconnectPolicy.maxAttempts == 0 || reconnectAttempts < reconnectPolicy.maxAttempts);
+    reconnectInProgress = retry;
+    clientCleanup();
+    reconnectInProgress = false;
+    if (retry) {
+      scheduleReconnect();
+    }
+  }
+}
+
+void RemoteScales::scheduleReconnect() {
+  // Doubled in 64 bits, so a long initialDelayMs can't shift over into a short wait.
+  uint64_t doubledMs = static_cast<uint64_t>(reconnectPolicy.initialDelayMs) << std::min<uint8_t>(reconnectAttempts.load(), 16);
+  uint32_t delayMs = static_cast<uint32_t>(std::min<uint64_t>(doubledMs, reconnectPolicy.maxDelayMs));
+  RemoteScalesTimerWheel::getInstance()->schedule(this, ScaleTimer::RECONNECT, delayMs);
+  requestUpdate();
+}
+
+void RemoteScales::reconnect() {
+  reconnectAttempts++;
+  log("Reconnecting to %s, attempt %u\n", device.getName().c_str(), reconnectAttempts.load());
+  reconnectInProgress = true;
+  bool connected = connect() && clientIsConnected();
+  reconnectInProgress = false;
+  if (connected && connectionState == ConnectionState::CONNECTED) {
+    if (!isHandshaking()) {
+      reconnectAttempts = 0; // Otherwise once the handshake is done
+    }
+    return;
+  }
+
+  if (!reconnectPolicy.enabled || (reconnectPolicy.maxAttempts != 0 && reconnectAttempts >= reconnectPolicy.maxAttempts)) {
+    log("Giving up reconnecting after %u attempts\n", reconnectAttempts.load());
+    clientCleanup();
+    return;
+  }
+  setConnectionState(ConnectionState::RECONNECTING);
+  scheduleReconnect();
+}
+
+// Drops the connection, which is still up, and connects again under the reconnect policy.
+void RemoteScales::restartConnection() {
+  reconnectInProgress = true;
+  clientCleanup();
+  reconnectInProgress = false;
+  reconnectAttempts = 0;
+  reconnect();
+}
+
+bool RemoteScales::startHandshake() {
+  handshake.start();
+  if (!runHandshake()) {
+    clientCleanup();
+    return false;
+  }
+  return true;
+}
+
+// Runs a slice of the handshake and plans the next one on the timer wheel. Returns false if it failed.
+bool RemoteScales::runHandshake() {
+  HandshakeSequence::State state = handshake.run(HANDSHAKE_SLICE_MS);
+  if (state == HandshakeSequence::State::RUNNING) {
+    RemoteScalesTimerWheel::getInstance()->schedule(this, ScaleTimer::HANDSHAKE, handshake.getMillisUntilDeadline().value_or(0));
+    requestUpdate();
+    return true;
+  }
+  RemoteScalesTimerWheel::getInstance()->cancel(this, ScaleTimer::HANDSHAKE);
+  if (state == HandshakeSequence::State::FAILED) {
+    log("Handshake failed at %s\n", handshake.getStepName());
+    return false;
+  }
+  if (state == HandshakeSequence::State::DONE) {
+    log("Handshake done\n");
+    reconnectAttempts = 0;
+  }
+  return true;
+}
+
+void RemoteScales::feedHandshake(const uint8_t* data, size_t length) {
+  if (handshake.onNotification(data, length)) {
+    requestUpdate();
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// ----------------------------   Data stall watchdog    ---------------------------------
+// ---------------------------------------------------------------------------------------
+
+StallStats RemoteScales::getStallStats() {
+  std::lock_guard<std::mutex> lock(watchdogMutex);
+  return stallStats;
+}
+
+void RemoteScales::armWatchdog() {
+  uint32_t windowMs = getTimerInterval(ScaleTimer::WATCHDOG);
+  if (windowMs == 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(watchdogMutex);
+    watchdogStage = WatchdogStage::WATCHING;
+    watchdogSince = millis();
+  }
+  RemoteScalesTimerWheel::getInstance()->schedule(this, ScaleTimer::WATCHDOG, windowMs);
+  requestUpdate();
+}
+
+// The timer is always set for the moment the window would pass without a weight, so a stall is
+// noticed right when it reaches the window.
+void RemoteScales::checkDataStall() {
+  uint32_t windowMs = getTimerInterval(ScaleTimer::WATCHDOG);
+  if (windowMs == 0 || !clientIsConnected()) {
+    return;
+  }
+  uint32_t now = millis();
+  uint32_t trafficAt = lastTrafficAt;
+  std::unique_lock<std::mutex> lock(watchdogMutex);
+  uint32_t lastSeen = static_cast<int32_t>(trafficAt - watchdogSince) > 0 ? trafficAt : watchdogSince;
+  uint32_t silentMs = now - lastSeen;
+  if (silentMs < windowMs) {
+    RemoteScalesTimerWheel::getInstance()->schedule(this, ScaleTimer::WATCHDOG, windowMs - silentMs);
+    return;
+  }
+
+  if (watchdogStage == WatchdogStage::WATCHING) {
+    // Resubscribing writes to the scale, that is left to runTimers() so the timer wheel isn't held up.
+    stallStats.stalls++;
+    watchdogStage = WatchdogStage::RESUBSCRIBED;
+    watchdogSince = now;
+    lock.unlock();
+    log("No weight for %ums, resubscribing\n", silentMs);
+    {
+      std::lock_guard<std::mutex> keepaliveLock(keepaliveMutex);
+      learnSilenceTolerance(trafficAt, getTimerInterval(ScaleTimer::HEARTBEAT));
+    }
+    resubscribeDue = true;
+    requestUpdate();
+    return;
+  }
+  lock.unlock();
+  log("Weight didn't come back, reconnecting\n");
+  reconnectAfterStall();
+}
+
+void RemoteScales::resubscribeAfterStall() {
+  {
+    std::lock_guard<std::mutex> lock(watchdogMutex);
+    watchdogSince = millis();
+  }
+  if (!resubscribe()) {
+    log("Can't resubscribe, reconnecting\n");
+    reconnectAfterStall();
+    return;
+  }
+  RemoteScalesTimerWheel::getInstance()->schedule(this, ScaleTimer::WATCHDOG, getTimerInterval(ScaleTimer::WATCHDOG));
+}
+
+void RemoteScales::reconnectAfterStall() {
+  {
+    std::lock_guard<std::mutex> lock(watchdogMutex);
+    stallStats.reconnected++;
+    watchdogStage = WatchdogStage::WATCHING;
+  }
+  requestReconnect();
+}
+
+void RemoteScales::beginConnectTiming() {
+  std::lock_guard<std::mutex> lock(connectTimingMutex);
+  connectTiming = ConnectTiming();
+  connectTiming.pluginId = pluginId;
+  connectTiming.deviceName = device.getName();
+  connectTiming.startedAt = millis();
+  lastConnectPhaseAt = connectTiming.startedAt;
+  connectTimingActive = true;
+}
+
+void RemoteScales::markConnectPhase(ConnectPhase phase) {
+  std::lock_guard<std::mutex> lock(connectTimingMutex);
+  if (!connectTimingActive) {
+    return;
+  }
+  uint32_t now = millis();
+  connectTiming.phaseMs[static_cast<size_t>(phase)] += now - lastConnectPhaseAt;
+  connectTiming.lastPhase = phase;
+  lastConnectPhaseAt = now;
+}
+
+void RemoteScales::finishConnectTiming(bool succeeded) {
+  ConnectTiming timing;
+  {
+    std::lock_guard<std::mutex> lock(connectTimingMutex);
+    if (!connectTimingActive) {
+      return;
+    }
+    connectTimingActive = false;
+    connectTiming.succeeded = succeeded;
+    timing = connectTiming;
+  }
+  if (succeeded) {
+    log("Connected in %ums, first weight after %ums\n",
+      timing.getTotalMs() - timing.getPhaseMs(ConnectPhase::FIRST_WEIGHT), timing.getTotalMs());
+  }
+  ConnectTimingLog::getInstance()->add(timing);
+}
+
 NimBLERemoteService* RemoteScales::clientGetService(const NimBLEUUID uuid) {
   if (!clientIsConnected()) {
     log("Cannot get service, client is not connected\n");
@@ -66,6 +889,59 @@ NimBLERemoteService* RemoteScales::clientGetService(const NimBLEUUID uuid) {
 
 bool RemoteScales::clientIsConnected() { return client != nullptr && client->isConnected(); };
 
+bool RemoteScales::clientWrite(NimBLERemoteCharacteristic* characteristic, const uint8_t* data, size_t length, bool withResponse) {
+  std::lock_guard<std::recursive_mutex> lock(writeMutex);
+  writeStats.messages++;
+  if (writeBatchDepth == 0 || !writeBatching || withResponse) {
+    bool result = flushWriteBatch();
+    writeStats.writes++;
+    return characteristic->writeValue(data, length, withResponse) && result;
+  }
+
+  // An ATT write carries the MTU less 3 bytes of header, the MTU is 23 until a larger one is negotiated.
+  // getMTU() is 0 once the link is gone.
+  size_t maxLength = std::max<size_t>(client != nullptr ? client->getMTU() : 0, 23) - 3;
+  bool result = true;
+  if (characteristic != batchCharacteristic || batchBuffer.size() + length > maxLength) {
+    result = flushWriteBatch();
+  }
+  if (length > maxLength) {
+    writeStats.writes++;
+    return characteristic->writeValue(data, length, withResponse) && result;
+  }
+  batchCharacteristic = characteristic;
+  batchBuffer.insert(batchBuffer.end(), data, data + length);
+  return result;
+}
+
+void RemoteScales::beginWriteBatch() {
+  writeMutex.lock();
+  writeBatchDepth++;
+}
+
+void RemoteScales::endWriteBatch() {
+  if (--writeBatchDepth == 0) {
+    flushWriteBatch();
+  }
+  writeMutex.unlock();
+}
+
+bool RemoteScales::flushWriteBatch() {
+  if (batchBuffer.empty()) {
+    return true;
+  }
+  writeStats.writes++;
+  bool result = clientIsConnected() && batchCharacteristic->writeValue(batchBuffer.data(), batchBuffer.size(), false);
+  batchBuffer.clear();
+  batchCharacteristic = nullptr;
+  return result;
+}
+
+WriteStats RemoteScales::getWriteStats() {
+  std::lock_guard<std::recursive_mutex> lock(writeMutex);
+  return writeStats;
+}
+
 std::string RemoteScales::byteArrayToHexString(const uint8_t* byteArray, size_t length) {
   std::string hexString;
   hexString.reserve(length * 3); // Reserve space for the resulting string
@@ -92,11 +968,13 @@ void RemoteScalesScanner::initializeAsyncScan() {
   // for devices we're not interested in. This is important because the library will otherwise run out of
   // memory after a while.
   NimBLEDevice::getScan()->setAdvertisedDeviceCallbacks(this, true);
-  NimBLEDevice::getScan()->setInterval(500);
-  NimBLEDevice::getScan()->setWindow(100);
+  scheduler.begin(millis());
+  counters.reset(millis());
+  activeWindowOpen = false;
+  scanResponseRequested = false;
+  applyScanParameters();
   NimBLEDevice::getScan()->setMaxResults(0);
   NimBLEDevice::getScan()->setDuplicateFilter(false);
-  NimBLEDevice::getScan()->setActiveScan(true);
   NimBLEDevice::getScan()->start(0, nullptr, false); // Set to 0 for continuous
   isRunning = true;
 }
@@ -105,7 +983,10 @@ void RemoteScalesScanner::stopAsyncScan() {
   if (!isRunning) return;
   NimBLEDevice::getScan()->stop();
   NimBLEDevice::getScan()->clearResults();
-  alreadySeenAddresses.cleanup();
+  {
+    std::lock_guard<std::mutex> lock(discoveredScalesMutex);
+    deviceTable.clear();
+  }
   isRunning = false;
 }
 
@@ -114,17 +995,234 @@ void RemoteScalesScanner::restartAsyncScan() {
   initializeAsyncScan();
 }
 
+void RemoteScalesScanner::update() {
+  if (!isRunning) return;
+
+  uint32_t now = millis();
+  expireDiscoveredScales(now);
+
+  bool restartNeeded = scheduler.update(now);
+  if (scanPolicy == ScanPolicy::HYBRID) {
+    restartNeeded |= updateActiveWindow(now);
+  }
+  if (!restartNeeded) return;
+
+  // Scan parameters are only picked up when the scan is (re)started.
+  NimBLEDevice::getScan()->stop();
+  applyScanParameters();
+  NimBLEDevice::getScan()->start(0, nullptr, true);
+}
+
+void RemoteScalesScanner::notifyUserAction() {
+  scheduler.onUserAction(millis());
+}
+
+void RemoteScalesScanner::applyScanParameters() {
+  ScanParameters parameters = scheduler.getParameters();
+  NimBLEDevice::getScan()->setInterval(parameters.intervalMs);
+  NimBLEDevice::getScan()->setWindow(parameters.windowMs);
+  NimBLEDevice::getScan()->setActiveScan(scanPolicy == ScanPolicy::ACTIVE || activeWindowOpen);
+}
+
+// Opens a short active scanning window when onResult() found advertisers whose scan response we need.
+// Returns true when the scan has to be restarted for the change to take effect.
+bool RemoteScalesScanner::updateActiveWindow(uint32_t now) {
+  bool requested = scanResponseRequested.exchange(false);
+  if (activeWindowOpen) {
+    if (requested) {
+      activeWindowOpenedAt = now;
+    }
+    if (now - activeWindowOpenedAt < activeWindowDuration()) {
+      return false;
+    }
+    activeWindowOpen = false;
+    return true;
+  }
+  if (!requested) {
+    return false;
+  }
+  activeWindowOpen = true;
+  activeWindowOpenedAt = now;
+  return true;
+}
+
+// Long enough to cover a couple of scan intervals, so the advertiser gets a chance to be asked.
+uint32_t RemoteScalesScanner::activeWindowDuration() const {
+  return std::max<uint32_t>(2 * scheduler.getParameters().intervalMs, 500);
+}
+
+// Only scannable advertisers answer scan requests. Phones and laptops make up most of the traffic
+// in crowded places and are never scales, so don't bother asking them either.
+bool RemoteScalesScanner::mayBeScale(NimBLEAdvertisedDevice* advertisedDevice) {
+  uint8_t advType = advertisedDevice->getAdvType();
+  if (advType != BLE_HCI_ADV_TYPE_ADV_IND && advType != BLE_HCI_ADV_TYPE_ADV_SCAN_IND) {
+    return false;
+  }
+  if (advertisedDevice->haveManufacturerData()) {
+    std::string manufacturerData = advertisedDevice->getManufacturerData();
+    if (manufacturerData.size() >= 2) {
+      uint16_t companyId = static_cast<uint8_t>(manufacturerData[0]) | (static_cast<uint8_t>(manufacturerData[1]) << 8);
+      if (companyId == 0x004C || companyId == 0x0006) { // Apple, Microsoft
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 void RemoteScalesScanner::onResult(NimBLEAdvertisedDevice* advertisedDevice) {
-  if (std::string addrStr(reinterpret_cast<const char*>(advertisedDevice->getAddress().getNative()), 6); alreadySeenAddresses.exists(addrStr)) {
-    return;
+  uint32_t now = millis();
+  const uint8_t* address = advertisedDevice->getAddress().getNative();
+  std::string name = advertisedDevice->getName();
+  int rssi = advertisedDevice->getRSSI();
+  counters.onAdvert();
+
+  std::optional<DiscoveredDevice> updatedScale;
+  std::optional<DiscoveredDevice> newScale;
+  bool knownScale = false;
+  {
+    std::lock_guard<std::mutex> lock(discoveredScalesMutex);
+    DeviceTableEntry* entry = deviceTable.find(address);
+    counters.onTableLookup(entry != nullptr);
+    if (entry == nullptr) {
+      entry = deviceTable.insert(address, rssi, now);
+      if (entry == nullptr) {
+        return; // Table is full of scales
+      }
+    }
+    else {
+      deviceTable.touch(*entry, rssi, now);
+    }
+
+    // Passive adverts often lack the name, fall back to the one from an earlier scan response.
+    if (!name.empty()) {
+      deviceTable.setName(*entry, name);
+      if (entry->match == MatchResult::AWAITING_SCAN_RESPONSE) {
+        entry->match = MatchResult::UNKNOWN;
+      }
+    }
+    else {
+      name = entry->name;
+    }
+
+    switch (entry->match) {
+    case MatchResult::MATCHED:
+      knownScale = true;
+      updatedScale = refreshDiscoveredScale(advertisedDevice, name, entry->getRssi(), now);
+      break;
+    case MatchResult::UNKNOWN:
+      if (discoveredScales.size() >= MAX_DISCOVERED_SCALES) {
+        break;
+      }
+      counters.onRegistryMatch();
+      if (DiscoveredDevice device(advertisedDevice, name); RemoteScalesPluginRegistry::getInstance()->containsPluginForDevice(device)) {
+        counters.onScaleFound(now);
+        device.lastSeen = now;
+        device.rssi = entry->getRssi();
+        entry->match = MatchResult::MATCHED;
+        discoveredScales.push_back(device);
+        newScale = device;
+      }
+      else if (scanPolicy == ScanPolicy::HYBRID && name.empty() && mayBeScale(advertisedDevice)) {
+        // The name might live in the scan response, ask for it once.
+        entry->match = MatchResult::AWAITING_SCAN_RESPONSE;
+        scanResponseRequested = true;
+      }
+      else {
+        entry->match = MatchResult::NOT_MATCHED;
+      }
+      break;
+    case MatchResult::NOT_MATCHED:
+    case MatchResult::AWAITING_SCAN_RESPONSE:
+      break;
+    }
+  }
+
+  if (newScale) {
+    scheduler.onMatchingAdvert(now, true);
+    notifyDiscovery(DiscoveryEvent::APPEARED, *newScale);
+  }
+  else if (knownScale) {
+    scheduler.onMatchingAdvert(now, false);
+    if (updatedScale) {
+      notifyDiscovery(DiscoveryEvent::UPDATED, *updatedScale);
+    }
+  }
+}
+
+// Keeps the discovered scale in sync with its latest advert. Returns a copy of it if its advertised data changed.
+std::optional<DiscoveredDevice> RemoteScalesScanner::refreshDiscoveredScale(NimBLEAdvertisedDevice* advertisedDevice, const std::string& name, int rssi, uint32_t now) {
+  auto it = std::find_if(discoveredScales.begin(), discoveredScales.end(), [&](const DiscoveredDevice& device) {
+    return device.getAddress() == advertisedDevice->getAddress();
+  });
+  if (it == discoveredScales.end()) {
+    return std::nullopt;
+  }
+
+  it->lastSeen = now;
+  it->rssi = rssi;
+  std::string manufacturerData = advertisedDevice->getManufacturerData();
+  bool nameChanged = !name.empty() && name != it->name;
+  if (!nameChanged && manufacturerData == it->manufacturerData) {
+    return std::nullopt;
+  }
+  if (nameChanged) {
+    it->name = name;
+  }
+  it->manufacturerData = manufacturerData;
+  return *it;
+}
+
+void RemoteScalesScanner::expireDiscoveredScales(uint32_t now) {
+  std::vector<DiscoveredDevice> expiredScales;
+  {
+    std::lock_guard<std::mutex> lock(discoveredScalesMutex);
+    deviceTable.expire(now, [&](const DeviceTableEntry& entry) {
+      if (entry.match != MatchResult::MATCHED) {
+        return;
+      }
+      auto it = std::find_if(discoveredScales.begin(), discoveredScales.end(), [&](const DiscoveredDevice& device) {
+        return memcmp(device.getAddress().getNative(), entry.address, sizeof(entry.address)) == 0;
+      });
+      if (it != discoveredScales.end()) {
+        expiredScales.push_back(std::move(*it));
+        discoveredScales.erase(it);
+      }
+    });
+  }
+
+  for (const auto& device : expiredScales) {
+    notifyDiscovery(DiscoveryEvent::EXPIRED, device);
   }
-  if (RemoteScalesPluginRegistry::getInstance()->containsPluginForDevice(advertisedDevice)) {
-    discoveredScales.emplace_back(advertisedDevice);
+}
+
+void RemoteScalesScanner::setDiscoveryExpiry(uint32_t expiryMs) {
+  std::lock_guard<std::mutex> lock(discoveredScalesMutex);
+  deviceTable.setExpiry(expiryMs);
+}
+
+void RemoteScalesScanner::notifyDiscovery(DiscoveryEvent event, const DiscoveredDevice& device) {
+  if (discoveryCallback) {
+    discoveryCallback(event, device);
   }
 }
 
+std::vector<DiscoveredDevice> RemoteScalesScanner::getDiscoveredScales() {
+  std::lock_guard<std::mutex> lock(discoveredScalesMutex);
+  return discoveredScales;
+}
+
 void RemoteScalesScanner::cleanupDiscoveredScales() {
-  discoveredScales.clear();
+  std::vector<DiscoveredDevice> removedScales;
+  {
+    std::lock_guard<std::mutex> lock(discoveredScalesMutex);
+    removedScales.swap(discoveredScales);
+    discoveredScales.reserve(MAX_DISCOVERED_SCALES);
+    deviceTable.clear();
+  }
+  for (const auto& device : removedScales) {
+    notifyDiscovery(DiscoveryEvent::EXPIRED, device);
+  }
 }
 
 bool RemoteScalesScanner::isScanRunning() const {
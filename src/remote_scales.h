@@ -3,42 +3,297 @@
 #include <Arduino.h>
 #include <vector>
 #include <memory>
-#include <lru_cache.h>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <optional>
+#include "scan_scheduler.h"
+#include "device_table.h"
+#include "scanner_stats.h"
+#include "remote_scales_timer_wheel.h"
+#include "spsc_ring_buffer.h"
+#include "seqlock.h"
+#include "connect_timing.h"
+#include "handshake_sequence.h"
 
 
 class DiscoveredDevice {
 public:
   DiscoveredDevice(NimBLEAdvertisedDevice* device) :
   name(device->getName()), address(device->getAddress()), manufacturerData(device->getManufacturerData()) {}
+  DiscoveredDevice(NimBLEAdvertisedDevice* device, const std::string& name) :
+  name(name), address(device->getAddress()), manufacturerData(device->getManufacturerData()) {}
   const std::string& getName() const { return name; }
   const NimBLEAddress& getAddress() const { return address; }
   const std::string& getManufacturerData() const { return manufacturerData; }
+  uint32_t getLastSeen() const { return lastSeen; }
+  // Smoothed over the received adverts.
+  int getRssi() const { return rssi; }
 private:
+  friend class RemoteScalesScanner;
   std::string name;
   NimBLEAddress address;
   std::string manufacturerData;
+  uint32_t lastSeen = 0;
+  int rssi = 0;
 };
 
+struct WeightSample {
+  int32_t weightMg;
+  uint32_t timestamp; // millis() when the sample was received
+
+  float getWeight() const { return weightMg / 1000.f; }
+};
+
+enum class WeightUnit : uint8_t {
+  UNKNOWN,
+  GRAMS,
+  OUNCES,
+  MILLILITERS,
+};
+
+enum class TimerState : uint8_t {
+  UNKNOWN,
+  STOPPED,
+  RUNNING,
+};
+
+// What the scale reports besides weight. Fields stay at their UNKNOWN value for scales that don't report them.
+struct ScaleStatus {
+  static constexpr uint8_t BATTERY_UNKNOWN = 0xFF;
+  static constexpr uint8_t DECIMALS_UNKNOWN = 0xFF;
+
+  // Bits of the changedFields passed to the status callback.
+  static constexpr uint8_t BATTERY = 0x01;
+  static constexpr uint8_t UNITS = 0x02;
+  static constexpr uint8_t TIMER = 0x04;
+  static constexpr uint8_t DECIMALS = 0x08;
+
+  uint8_t batteryPercent = BATTERY_UNKNOWN;
+  WeightUnit units = WeightUnit::UNKNOWN;
+  TimerState timerState = TimerState::UNKNOWN;
+  uint8_t decimals = DECIMALS_UNKNOWN;  // Precision of the weight shown on the scale
+  uint32_t timerMs = 0;
+};
+
+// Everything the application usually reads about the scales, consistent as of one moment.
+struct ScaleSnapshot {
+  int32_t weightMg = 0;
+  uint32_t timestamp = 0;       // millis() when the last weight was received
+  int32_t flowMgPerSecond = 0;  // Smoothed over the last few samples
+  ScaleStatus status;
+  bool connected = false;
+
+  float getWeight() const { return weightMg / 1000.f; }
+  float getFlow() const { return flowMgPerSecond / 1000.f; }
+};
+
+enum class TareState : uint8_t {
+  PENDING,
+  CONFIRMED,  // The scale acknowledged the tare, or its weight settled near zero.
+  FAILED,     // The command couldn't be sent, or the connection was lost.
+  TIMED_OUT,
+  SUPERSEDED, // Another tareAsync() was started before this one completed.
+};
+
+// Progress of one tareAsync(), updated from the BLE host task.
+class TareOperation {
+public:
+  TareState getState() const { return state; }
+  bool isDone() const { return state != TareState::PENDING; }
+  // Time from sending the command until it was confirmed. 0 unless CONFIRMED.
+  uint32_t getLatencyMs() const { return latencyMs; }
+
+private:
+  friend class RemoteScales;
+  std::atomic<TareState> state{ TareState::PENDING };
+  std::atomic<uint32_t> latencyMs{ 0 };
+  uint32_t startedAt = 0;
+  bool commandSent = false;
+  uint32_t commandSentAt = 0;
+  uint8_t samplesNearZero = 0;
+};
+using TareHandle = std::shared_ptr<const TareOperation>;
+
+struct TareStats {
+  uint32_t confirmed = 0;
+  uint32_t timedOut = 0;
+  uint32_t failed = 0;
+  uint32_t superseded = 0;
+  uint32_t lastLatencyMs = 0;
+  uint32_t maxLatencyMs = 0;
+  uint32_t totalLatencyMs = 0;
+
+  uint32_t getAverageLatencyMs() const { return confirmed > 0 ? totalLatencyMs / confirmed : 0; }
+};
+
+// Connection parameters a plugin asks for. As in NimBLE, intervals are in units of 1.25ms and
+// the supervision timeout in units of 10ms. Fields left at 0 keep NimBLE's defaults.
+struct LinkProfile {
+  uint16_t minInterval = 0;
+  uint16_t maxInterval = 0;
+  uint16_t latency = 0;  // Connection events the scale may skip when it has nothing to send
+  uint16_t supervisionTimeout = 0;
+  uint16_t mtu = 0;
+};
+
+// 7.5-15ms, for scales that notify the weight often.
+constexpr LinkProfile LOW_LATENCY_LINK_PROFILE = { .minInterval = 6, .maxInterval = 12, .latency = 0, .supervisionTimeout = 200 };
+
+// What the scale accepted, in the same units as LinkProfile.
+struct LinkParameters {
+  uint16_t interval = 0;
+  uint16_t latency = 0;
+  uint16_t supervisionTimeout = 0;
+  uint16_t mtu = 0;
+
+  float getIntervalMs() const { return interval * 1.25f; }
+};
+
+enum class StreamingProfile : uint8_t {
+  MAX_RATE,   // As many weight notifications as the scale can send.
+  BALANCED,   // The driver's default.
+  LOW_POWER,  // Fewer notifications, saving battery on both ends.
+};
+
+enum class KeepalivePolicy : uint8_t {
+  FIXED,     // Send every heartbeat.
+  ADAPTIVE,  // Skip heartbeats while weight notifications show the link is alive, learning how long the scale tolerates that.
+};
+
+struct KeepaliveStats {
+  uint32_t sent = 0;
+  uint32_t skipped = 0;
+  uint32_t allowedGapMs = 0;         // Current longest time between heartbeats while notifications arrive
+  uint32_t silenceToleranceMs = 0;   // Heartbeat gap after which the scale stopped notifying, 0 until seen
+};
+
+struct WriteStats {
+  uint32_t messages = 0;  // Messages the driver wrote
+  uint32_t writes = 0;    // ATT writes they went out in
+};
+
+enum class ConnectionState : uint8_t {
+  DISCONNECTED,
+  CONNECTED,
+  RECONNECTING,  // The link was lost and the ReconnectPolicy is retrying.
+};
+
+// Retries after the link was lost, waiting initialDelayMs and doubling the wait after each failed attempt.
+struct ReconnectPolicy {
+  bool enabled = true;
+  uint32_t initialDelayMs = 500;
+  uint32_t maxDelayMs = 30000;
+  uint8_t maxAttempts = 0;  // 0 keeps trying
+};
+
+// Recoveries of the data stall watchdog.
+struct StallStats {
+  uint32_t stalls = 0;
+  uint32_t resubscribed = 0;    // Weight came back after resubscribing
+  uint32_t reconnected = 0;     // Resubscribing didn't help or the driver can't, so the connection was restarted
+  uint32_t lastRecoveryMs = 0;  // From resubscribing to the next weight
+};
+
+enum class CallbackExecutor : uint8_t {
+  INLINE,      // Callbacks run where the event happened, usually the BLE host task.
+  DEFERRED,    // Callbacks are queued until the application calls runCallbacks() from its own task.
+  SCALE_TASK,  // Callbacks run on the RemoteScalesTask these scales were added to.
+};
+
+class RemoteScalesTask;
+
 class RemoteScales {
 
 public:
   using LogCallback = void (*)(std::string);
+  using SampleListener = std::function<void(const WeightSample& sample)>;
+  using StatusCallback = void (*)(const ScaleStatus& status, uint8_t changedFields);
+  using ConnectionCallback = void (*)(ConnectionState state);
 
-  float getWeight() const { return weight; }
+  // Weight is kept in integer milligrams, the float in grams is only a view of it.
+  float getWeight() const { return getSnapshot().getWeight(); }
+  int32_t getWeightMilligrams() const { return getSnapshot().weightMg; }
+  // Lock-free and safe to call from any task or core, while the BLE host task keeps updating the scales.
+  ScaleSnapshot getSnapshot() const { return snapshot.load(); }
 
   void setWeightUpdatedCallback(void (*callback)(float), bool onlyChanges = false);
+  void setWeightMilligramsUpdatedCallback(void (*callback)(int32_t), bool onlyChanges = false);
   void setLogCallback(LogCallback logCallback) { this->logCallback = logCallback; }
 
+  ScaleStatus getStatus() const { return getSnapshot().status; }
+  // Only invoked when a field actually changes.
+  void setStatusUpdatedCallback(StatusCallback callback) { statusCallback = callback; }
+
+  // A lost link is reported as soon as NimBLE notices it, not on the next update().
+  ConnectionState getConnectionState() const { return connectionState; }
+  void setConnectionStateCallback(ConnectionCallback callback) { connectionCallback = callback; }
+  // Reconnect attempts run from update(), so the application or RemoteScalesTask must keep calling it.
+  void setReconnectPolicy(const ReconnectPolicy& policy) { reconnectPolicy = policy; }
+  const ReconnectPolicy& getReconnectPolicy() const { return reconnectPolicy; }
+
+  // Where the weight, status and connection state callbacks run. Sample listeners always run inline.
+  void setCallbackExecutor(CallbackExecutor executor) { callbackExecutor = executor; }
+  CallbackExecutor getCallbackExecutor() const { return callbackExecutor; }
+  // Runs the queued callbacks, returns how many. Only one task may run them.
+  size_t runCallbacks();
+  size_t getDroppedCallbacks() const { return callbackQueue.getDropped(); }
+
+  // Listeners receive every sample, from the BLE host task. They can be added and removed at any time,
+  // once removeSampleListener() returns the listener isn't running and won't be called again.
+  size_t addSampleListener(SampleListener listener);
+  void removeSampleListener(size_t listenerId);
+
+  // Drivers set the intervals their protocol needs, the application may override them.
+  // Changing the interval of a running periodic timer reschedules it.
+  void setTimerInterval(ScaleTimer timer, uint32_t intervalMs);
+  uint32_t getTimerInterval(ScaleTimer timer) const { return timerIntervals[static_cast<size_t>(timer)]; }
+
+  // Each driver maps the profile to what its protocol offers, scales without a choice ignore it.
+  // Applied right away when connected, otherwise on connect.
+  void setStreamingProfile(StreamingProfile profile);
+  StreamingProfile getStreamingProfile() const { return streamingProfile; }
+  // Weight samples per second actually received, smoothed. 0 until samples arrive.
+  float getSampleRate() const;
+
+  // Drivers whose scales keep streaming without heartbeats for a while opt in to ADAPTIVE.
+  void setKeepalivePolicy(KeepalivePolicy policy) { keepalivePolicy = policy; }
+  KeepalivePolicy getKeepalivePolicy() const { return keepalivePolicy; }
+  KeepaliveStats getKeepaliveStats();
+  WriteStats getWriteStats();
+
+  // Set from the plugin, applied on the next connect.
+  void setLinkProfile(const LinkProfile& profile) { linkProfile = profile; }
+  const LinkProfile& getLinkProfile() const { return linkProfile; }
+  // The parameters of the current connection. All 0 while disconnected.
+  LinkParameters getLinkParameters();
+  const std::string& getPluginId() const { return pluginId; }
+
   std::string getDeviceName() const { return device.getName(); }
   std::string getDeviceAddress() const { return device.getAddress().toString(); }
 
   virtual bool tare() = 0;
+  // Sends the tare command and returns right away. The handle completes when the scale acknowledges
+  // the tare, on protocols that do, or once the weight settled within tareToleranceMg of zero.
+  TareHandle tareAsync(uint32_t timeoutMs = 2000);
+  // Like tareAsync(), but zeroes the published weight straight away with a software offset. Once the
+  // scale's readings show its own tare took effect, the offset is blended out without a step in the weight.
+  // If the tare fails or times out, the offset is dropped again.
+  TareHandle tareHybrid(uint32_t timeoutMs = 2000);
+  void setTareTolerance(int32_t toleranceMg) { tareToleranceMg = toleranceMg; }
+  TareStats getTareStats();
+  // Drivers of scales that stream the weight continuously set the WATCHDOG interval. When no weight arrives
+  // for that long, the scales resubscribe and, if the weight still doesn't come back, reconnect.
+  StallStats getStallStats();
   virtual bool isConnected() = 0;
   virtual bool connect() = 0;
   virtual void disconnect() = 0;
   virtual void update() = 0;
 
-  ~RemoteScales() { clientCleanup(); }
+  virtual ~RemoteScales() {
+    clientCleanup();
+    RemoteScalesTimerWheel::getInstance()->remove(this);
+  }
 protected:
   RemoteScales(const DiscoveredDevice& device);
   const DiscoveredDevice& getDevice() const { return device; }
@@ -47,41 +302,302 @@ protected:
   void clientCleanup();
   bool clientIsConnected();
   NimBLERemoteService* clientGetService(const NimBLEUUID uuid);
+  // Drivers write their commands through here. Between beginWriteBatch() and endWriteBatch() the writes
+  // without response to one characteristic are joined into as few writes as the MTU allows, if the driver
+  // enabled batching. Only for protocols whose scales parse commands from a stream of frames.
+  bool clientWrite(NimBLERemoteCharacteristic* characteristic, const uint8_t* data, size_t length, bool withResponse = false);
+  void setWriteBatching(bool enabled) { writeBatching = enabled; }
+  void beginWriteBatch();
+  void endWriteBatch();
+
+  // Drivers report the weight as the scale sends it, any software tare offset is applied here.
+  // Only from the BLE host task: it is the single producer of the listeners' sample streams.
+  void setWeightMilligrams(int32_t rawWeightMg);
+  // Zeroes the weight while connecting. Nothing is published: no callback, no listener sample, and
+  // it doesn't count as the first weight notification. Safe to call from the app task.
+  void resetWeight();
+  // For protocols that report grams as a float.
+  void setWeight(float newWeight) { setWeightMilligrams(static_cast<int32_t>(lroundf(newWeight * 1000.f))); }
+  void setBattery(uint8_t batteryPercent);
+  void setWeightUnit(WeightUnit units);
+  void setTimer(TimerState timerState, uint32_t timerMs);
+  void setDecimals(uint8_t decimals);
+  // Timers run on the shared RemoteScalesTimerWheel and are all stopped by clientCleanup().
+  void startTimer(ScaleTimer timer, bool periodic = true);
+  void stopTimer(ScaleTimer timer);
+  // Runs the due timers, and resubscribes or connects again if a lost link or the watchdog asked for it.
+  // Drivers call this from update(), so those writes happen on the task that updates these scales.
+  void runTimers();
+  virtual void onTimer(ScaleTimer timer) {}
+  virtual void applyStreamingProfile(StreamingProfile profile) {}
+  // Subscribes to the weight notifications again and repeats whatever request starts them, without reconnecting.
+  // Returns false if that isn't possible, then a stall is recovered by reconnecting.
+  virtual bool resubscribe() { return false; }
+  // Completes a phase of the current connection in its ConnectTiming. clientConnect() marks CLIENT_CONNECT
+  // and the first weight marks FIRST_WEIGHT, drivers mark what happens in between.
+  void markConnectPhase(ConnectPhase phase);
+  // For drivers whose protocol acknowledges a tare.
+  void confirmTare();
+  // Drivers that add steps to handshake in their constructor call startHandshake() once the link is up.
+  // It runs the first slice and returns false if that failed, with the connection cleaned up. runTimers()
+  // runs the rest, a failure then counts as a failed connection attempt of the reconnect policy.
+  HandshakeSequence handshake;
+  bool startHandshake();
+  bool isHandshaking() const { return handshake.getState() == HandshakeSequence::State::RUNNING; }
+  // Drivers pass the scale's notifications on, for the steps that wait for one. Safe to call from the BLE host task.
+  void feedHandshake(const uint8_t* data, size_t length);
+  // Asks for update() to be called soon, i.e. after marking the scales for reconnection from a notification.
+  void requestUpdate();
+  // Drops the connection, which is still up, and connects again under the reconnect policy from the next
+  // update(). For scales that report a broken session. Safe to call from the BLE host task.
+  void requestReconnect();
 
-  void setWeight(float newWeight);
   void log(std::string msgFormat, ...);
   std::string byteArrayToHexString(const uint8_t* byteArray, size_t length);
 
 private:
+  friend class RemoteScalesTimerWheel;
+  friend class RemoteScalesTask;
+  friend class RemoteScalesPluginRegistry;
   using WeightCallback = void (*)(float);
+  using WeightMilligramsCallback = void (*)(int32_t);
+
+  struct QueuedCallback {
+    enum class Kind : uint8_t { WEIGHT, STATUS, CONNECTION_STATE } kind;
+    int32_t weightMg;
+    bool weightChanged;
+    uint8_t changedFields;
+    ScaleStatus status;
+    ConnectionState connectionState;
+  };
+
+  // Registered on every client, so a lost link is noticed on the BLE host task right away.
+  class ClientCallbacks : public NimBLEClientCallbacks {
+  public:
+    ClientCallbacks(RemoteScales* scales) : scales(scales) {}
+    void onDisconnect(NimBLEClient* client) override { scales->handleLinkLost(); }
+  private:
+    RemoteScales* scales;
+  };
+
+  ScaleStatus status;
+  // The writers' copy of the snapshot. Weight and status are written from the BLE host task,
+  // the connection state from the task that connects.
+  std::mutex snapshotMutex;
+  ScaleSnapshot snapshotDraft;
+  Seqlock<ScaleSnapshot> snapshot;
+
+  enum class TareOffsetState : uint8_t { NONE, AWAITING_SCALE, BLENDING };
+  // Software tare, guarded by snapshotMutex.
+  int32_t lastRawWeightMg = 0;
+  int32_t tareOffsetMg = 0;
+  TareOffsetState tareOffsetState = TareOffsetState::NONE;
+  int32_t applyTareOffset(int32_t rawWeightMg, int32_t previousWeightMg);
+  StatusCallback statusCallback = nullptr;
+
+  void notifyStatusChanged(uint8_t changedFields);
+  void dispatchWeight(int32_t weightMg, bool changed);
+  void setConnected(bool connected);
+  void queueCallback(const QueuedCallback& callback);
+  void handleTimer(ScaleTimer timer);
+
+  ClientCallbacks clientCallbacks{ this };
+  std::atomic<ConnectionState> connectionState{ ConnectionState::DISCONNECTED };
+  ConnectionCallback connectionCallback = nullptr;
+  ReconnectPolicy reconnectPolicy;
+  std::atomic<bool> reconnectInProgress{ false };
+  std::atomic<uint8_t> reconnectAttempts{ 0 };
+  // Set by the BLE host task, the timer wheel and requestReconnect(), handled by runTimers() on the task
+  // that calls update().
+  std::atomic<bool> linkLost{ false };
+  std::atomic<bool> reconnectDue{ false };
+  std::atomic<bool> restartDue{ false };
+  std::atomic<bool> resubscribeDue{ false };
+  void setConnectionState(ConnectionState state);
+  void publishConnectionState(ConnectionState state);
+  void handleLinkLost();
+  void reconnect();
+  void scheduleReconnect();
+  void restartConnection();
+
+  // How long one update() spends on the handshake before the other scales on the task get their turn.
+  static constexpr uint32_t HANDSHAKE_SLICE_MS = 50;
+  bool runHandshake();
+
+  enum class WatchdogStage : uint8_t { WATCHING, RESUBSCRIBED };
+  // The watchdog is armed by the first weight after connecting.
+  std::mutex watchdogMutex;
+  std::atomic<WatchdogStage> watchdogStage{ WatchdogStage::WATCHING };
+  uint32_t watchdogSince = 0;  // millis() when arming or resubscribing, silence is counted from here or the last weight
+  StallStats stallStats;
+  void armWatchdog();
+  void resubscribeAfterStall();
+  void reconnectAfterStall();
+  void checkDataStall();
+
+  // Guards pendingTare and tareStats, which are completed from the BLE host task.
+  std::mutex tareMutex;
+  std::shared_ptr<TareOperation> pendingTare;
+  TareStats tareStats;
+  int32_t tareToleranceMg = 100;
+  void updatePendingTare(int32_t weightMg);
+  void completeTare(TareState state);
 
-  float weight = 0.f;
+  CallbackExecutor callbackExecutor = CallbackExecutor::INLINE;
+  std::mutex callbackQueueMutex;  // Connection state changes are queued from other tasks than the BLE host task
+  SpscRingBuffer<QueuedCallback, 32> callbackQueue;
+  std::atomic<RemoteScalesTask*> task{ nullptr };
 
   NimBLEClient* client = nullptr;
   DiscoveredDevice device;
+  std::string pluginId;
+  LinkProfile linkProfile;
+  std::atomic<StreamingProfile> streamingProfile{ StreamingProfile::BALANCED };
+  std::atomic<uint32_t> sampleIntervalQ4{ 0 };  // Smoothed ms between samples, in 1/16 ms
+  void applyLinkProfile();
+
+  // Held from beginWriteBatch() to endWriteBatch(), so writes of other tasks don't end up in the batch.
+  std::recursive_mutex writeMutex;
+  bool writeBatching = false;
+  uint8_t writeBatchDepth = 0;
+  NimBLERemoteCharacteristic* batchCharacteristic = nullptr;
+  std::vector<uint8_t> batchBuffer;
+  WriteStats writeStats;
+  bool flushWriteBatch();
+
+  // Heartbeat suppression, decided when the HEARTBEAT timer fires.
+  static constexpr uint32_t MAX_HEARTBEAT_GAP_FACTOR = 5;
+  std::mutex keepaliveMutex;
+  std::atomic<KeepalivePolicy> keepalivePolicy{ KeepalivePolicy::FIXED };
+  std::atomic<uint32_t> lastTrafficAt{ 0 };
+  uint32_t lastHeartbeatAt = 0;
+  KeepaliveStats keepaliveStats;
+  bool shouldSendHeartbeat();
+  void restoreKeepalive();
+  void learnSilenceTolerance(uint32_t trafficAt, uint32_t intervalMs);
+  uint32_t getMaxHeartbeatGap(uint32_t intervalMs);
+
+  // Tolerances learned per scale address, so a reconnect or a new scales object for the same scale
+  // doesn't stretch the heartbeat gap into the same silence again. The oldest is dropped when full.
+  struct LearnedTolerance {
+    NimBLEAddress address;
+    uint32_t silenceToleranceMs;
+  };
+  static constexpr size_t LEARNED_TOLERANCE_CAPACITY = 8;
+  static std::mutex learnedTolerancesMutex;
+  static std::vector<LearnedTolerance> learnedTolerances;
+
+  // Timing of the connection in progress, until the first weight arrives or the connection fails.
+  std::mutex connectTimingMutex;
+  ConnectTiming connectTiming;
+  uint32_t lastConnectPhaseAt = 0;
+  std::atomic<bool> connectTimingActive{ false };
+  void beginConnectTiming();
+  void finishConnectTiming(bool succeeded);
   LogCallback logCallback = nullptr;
   WeightCallback weightCallback = nullptr;
+  WeightMilligramsCallback weightMilligramsCallback = nullptr;
   bool weightCallbackOnlyChanges = false;
+  bool weightMilligramsCallbackOnlyChanges = false;
+  // Held while the listeners run, so removing one waits for a sample being delivered to it.
+  std::mutex sampleListenersMutex;
+  std::vector<std::pair<size_t, SampleListener>> sampleListeners;
+  size_t nextSampleListenerId = 0;
+  uint32_t timerIntervals[SCALE_TIMER_COUNT] = {};
+  bool timerPeriodic[SCALE_TIMER_COUNT] = {};
 };
 
 // ---------------------------------------------------------------------------------------
 // ---------------------------   RemoteScalesScanner    -----------------------------------
 // ---------------------------------------------------------------------------------------
+enum class ScanPolicy : uint8_t {
+  ACTIVE,   // Send a scan request to every advertiser.
+  PASSIVE,  // Never send scan requests; scales that only put their name in the scan response won't be found.
+  HYBRID,   // Scan passively and only briefly turn active scanning on for unknown advertisers that could be scales.
+};
+
+enum class DiscoveryEvent : uint8_t {
+  APPEARED,  // A scale matching one of the registered plugins was seen for the first time.
+  UPDATED,   // A known scale advertised a different name or manufacturer data.
+  EXPIRED,   // A known scale hasn't advertised for a while, or the scan was restarted.
+};
+
+// Gives access to the discovered scales without copying them. The scanner can't add or
+// remove scales while a view is alive, so don't hold on to it.
+class DiscoveredScalesView {
+public:
+  DiscoveredScalesView(std::mutex& mutex, const std::vector<DiscoveredDevice>& devices) : lock(mutex), devices(devices) {}
+  std::vector<DiscoveredDevice>::const_iterator begin() const { return devices.begin(); }
+  std::vector<DiscoveredDevice>::const_iterator end() const { return devices.end(); }
+  const DiscoveredDevice& operator[](size_t index) const { return devices[index]; }
+  size_t size() const { return devices.size(); }
+  bool empty() const { return devices.empty(); }
+private:
+  std::unique_lock<std::mutex> lock;
+  const std::vector<DiscoveredDevice>& devices;
+};
+
 class RemoteScalesScanner : public NimBLEAdvertisedDeviceCallbacks {
+public:
+  using DiscoveryCallback = std::function<void(DiscoveryEvent event, const DiscoveredDevice& device)>;
+
 private:
+  static constexpr size_t DEVICE_TABLE_CAPACITY = 64;
+  static constexpr size_t MAX_DISCOVERED_SCALES = 8;
+
   bool isRunning = false;
-  LRUCache alreadySeenAddresses = LRUCache(100);
+  // Guards deviceTable and discoveredScales, which are written from the BLE host task.
+  std::mutex discoveredScalesMutex;
+  DeviceTable deviceTable = DeviceTable(DEVICE_TABLE_CAPACITY, 0);
   std::vector<DiscoveredDevice> discoveredScales;
+  DiscoveryCallback discoveryCallback = nullptr;
+  ScanScheduler scheduler;
+  ScannerCounters counters;
+
+  ScanPolicy scanPolicy = ScanPolicy::ACTIVE;
+  std::atomic<bool> scanResponseRequested{ false };
+  bool activeWindowOpen = false;
+  uint32_t activeWindowOpenedAt = 0;
+
   void cleanupDiscoveredScales();
+  void expireDiscoveredScales(uint32_t now);
+  std::optional<DiscoveredDevice> refreshDiscoveredScale(NimBLEAdvertisedDevice* advertisedDevice, const std::string& name, int rssi, uint32_t now);
+  void notifyDiscovery(DiscoveryEvent event, const DiscoveredDevice& device);
+  void applyScanParameters();
+  bool updateActiveWindow(uint32_t now);
+  uint32_t activeWindowDuration() const;
+  static bool mayBeScale(NimBLEAdvertisedDevice* advertisedDevice);
   void onResult(NimBLEAdvertisedDevice* advertisedDevice) override;
 
 public:
-  std::vector<DiscoveredDevice> getDiscoveredScales() { return discoveredScales; }
+  std::vector<DiscoveredDevice> getDiscoveredScales();
+  DiscoveredScalesView viewDiscoveredScales() { return DiscoveredScalesView(discoveredScalesMutex, discoveredScales); }
+
+  // The callback is invoked from the BLE host task, so keep it short and don't connect from it.
+  void setDiscoveryCallback(DiscoveryCallback callback) { discoveryCallback = callback; }
+  // Devices that haven't advertised for this long are dropped during update(). 0, the default, keeps them
+  // until the scan is stopped, or until they have to make room for others when more than
+  // DEVICE_TABLE_CAPACITY devices are around. Connected scales stop advertising, so they expire too.
+  void setDiscoveryExpiry(uint32_t expiryMs);
 
   void initializeAsyncScan();
   void stopAsyncScan();
   void restartAsyncScan();
   bool isScanRunning() const;
+
+  // Moves the scan between duty-cycles. Should be called periodically while the scan is running.
+  void update();
+  // Switches to high duty scanning, i.e. when the user is actively looking for a scale.
+  void notifyUserAction();
+  ScanMode getScanMode() const { return scheduler.getMode(); }
+  ScanScheduler& getScheduler() { return scheduler; }
+
+  ScannerStats getStats() const { return counters.snapshot(millis()); }
+  void resetStats() { counters.reset(millis()); }
+
+  // Takes effect the next time the scan is started.
+  void setScanPolicy(ScanPolicy policy) { scanPolicy = policy; }
+  ScanPolicy getScanPolicy() const { return scanPolicy; }
 };
 
 // ---------------------------------------------------------------------------------------
@@ -0,0 +1,128 @@
+#include "remote_scales_auto_connect.h"
+#include "remote_scales_plugin_registry.h"
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   RemoteScalesAutoConnect    ------------------------------
+// ---------------------------------------------------------------------------------------
+
+void RemoteScalesAutoConnect::begin(RemoteScalesScanner& scanner) {
+  this->scanner = &scanner;
+  scanner.setDiscoveryCallback([this](DiscoveryEvent event, const DiscoveredDevice& device) { onDiscovery(event, device); });
+  state = AutoConnectState::SCANNING;
+
+  // Scales discovered before we were listening won't appear again.
+  for (const auto& device : scanner.getDiscoveredScales()) {
+    onDiscovery(DiscoveryEvent::APPEARED, device);
+  }
+  if (state == AutoConnectState::SCANNING && !scanner.isScanRunning()) {
+    scanner.initializeAsyncScan();
+  }
+}
+
+void RemoteScalesAutoConnect::update() {
+  switch (state) {
+  case AutoConnectState::IDLE:
+    break;
+  case AutoConnectState::SCANNING: {
+    scanner->update();
+    // Discovery events only fire when the advertised data changes, so pick up scales
+    // that came within range of the RSSI preference here.
+    std::optional<DiscoveredDevice> candidate;
+    for (const auto& device : scanner->viewDiscoveredScales()) {
+      if (matchesPreferences(device)) {
+        candidate = device;
+        break;
+      }
+    }
+    if (candidate) {
+      pickDevice(*candidate);
+    }
+    break;
+  }
+  case AutoConnectState::CONNECTING:
+    connectPendingDevice();
+    break;
+  case AutoConnectState::CONNECTED:
+    scales->update();
+    // While RECONNECTING the reconnect policy is still trying.
+    if (scales->getConnectionState() == ConnectionState::DISCONNECTED) {
+      scales.reset();
+      resumeScanning();
+    }
+    break;
+  }
+}
+
+// Called from the BLE host task.
+void RemoteScalesAutoConnect::onDiscovery(DiscoveryEvent event, const DiscoveredDevice& device) {
+  if (discoveryCallback) {
+    discoveryCallback(event, device);
+  }
+  if (event == DiscoveryEvent::EXPIRED || !matchesPreferences(device)) {
+    return;
+  }
+  pickDevice(device);
+}
+
+// The scan keeps running until connectPendingDevice() stops it from update(). Stopping it here, in the
+// middle of NimBLE delivering an advert, would free that advert under the scanner.
+void RemoteScalesAutoConnect::pickDevice(const DiscoveredDevice& device) {
+  AutoConnectState expected = AutoConnectState::SCANNING;
+  if (!state.compare_exchange_strong(expected, AutoConnectState::CONNECTING)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(pendingDeviceMutex);
+    pendingDevice = device;
+  }
+}
+
+bool RemoteScalesAutoConnect::matchesPreferences(const DiscoveredDevice& device) const {
+  if (preferences.empty()) {
+    return true;
+  }
+
+  const RemoteScalesPlugin* plugin = RemoteScalesPluginRegistry::getInstance()->getPluginForDevice(device);
+  for (const auto& preference : preferences) {
+    if (!preference.address.empty() && preference.address != device.getAddress().toString()) {
+      continue;
+    }
+    if (!preference.pluginId.empty() && (plugin == nullptr || preference.pluginId != plugin->id)) {
+      continue;
+    }
+    if (device.getRssi() < preference.minRssi) {
+      continue;
+    }
+    return true;
+  }
+  return false;
+}
+
+void RemoteScalesAutoConnect::connectPendingDevice() {
+  std::optional<DiscoveredDevice> device;
+  {
+    std::lock_guard<std::mutex> lock(pendingDeviceMutex);
+    device.swap(pendingDevice);
+  }
+  if (!device) {
+    return;
+  }
+
+  scanner->stopAsyncScan();
+  scales = RemoteScalesFactory::getInstance()->create(*device);
+  if (scales == nullptr || !scales->connect()) {
+    scales.reset();
+    resumeScanning();
+    return;
+  }
+
+  state = AutoConnectState::CONNECTED;
+  if (connectedCallback) {
+    connectedCallback(scales.get());
+  }
+}
+
+void RemoteScalesAutoConnect::resumeScanning() {
+  state = AutoConnectState::SCANNING;
+  scanner->initializeAsyncScan();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "remote_scales.h"
+#include <mutex>
+#include <optional>
+
+struct AutoConnectPreference {
+  std::string address;   // Remembered scale address as in getDeviceAddress(). Empty matches any address.
+  std::string pluginId;  // i.e. "plugin-acaia". Empty matches any plugin.
+  int minRssi = -127;    // Ignore scales further away than this.
+};
+
+enum class AutoConnectState : uint8_t {
+  IDLE,        // begin() wasn't called yet.
+  SCANNING,    // Waiting for a scale matching one of the preferences.
+  CONNECTING,  // A scale was picked and will be connected on the next update().
+  CONNECTED,
+};
+
+// Connects to the first advertising scale that matches one of the preferences.
+// The decision is taken straight from the scanner's discovery callback. NimBLE can't stop the scan or
+// connect from its own host task, so both happen in the next update().
+class RemoteScalesAutoConnect {
+public:
+  using ConnectedCallback = void (*)(RemoteScales* scales);
+
+  void addPreference(AutoConnectPreference preference) { preferences.push_back(preference); }
+  void clearPreferences() { preferences.clear(); }
+
+  // Takes over the scanner's discovery callback, use setDiscoveryCallback() here to still receive events.
+  void begin(RemoteScalesScanner& scanner);
+  void update();
+
+  void setDiscoveryCallback(RemoteScalesScanner::DiscoveryCallback callback) { discoveryCallback = callback; }
+  void setConnectedCallback(ConnectedCallback callback) { connectedCallback = callback; }
+
+  AutoConnectState getState() const { return state; }
+  RemoteScales* getScales() { return scales.get(); }
+
+private:
+  std::vector<AutoConnectPreference> preferences;
+  RemoteScalesScanner* scanner = nullptr;
+  std::unique_ptr<RemoteScales> scales;
+  std::atomic<AutoConnectState> state{ AutoConnectState::IDLE };
+
+  std::mutex pendingDeviceMutex;
+  std::optional<DiscoveredDevice> pendingDevice;
+
+  RemoteScalesScanner::DiscoveryCallback discoveryCallback = nullptr;
+  ConnectedCallback connectedCallback = nullptr;
+
+  void onDiscovery(DiscoveryEvent event, const DiscoveredDevice& device);
+  void pickDevice(const DiscoveredDevice& device);
+  bool matchesPreferences(const DiscoveredDevice& device) const;
+  void connectPendingDevice();
+  void resumeScanning();
+};
@@ -0,0 +1,72 @@
+#include "remote_scales_client_pool.h"
+
+RemoteScalesClientPool* RemoteScalesClientPool::instance = nullptr;
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   RemoteScalesClientPool    -------------------------------
+// ---------------------------------------------------------------------------------------
+
+NimBLEClient* RemoteScalesClientPool::acquire(const NimBLEAddress& address, bool& keepAttributes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  keepAttributes = false;
+  for (auto it = idleClients.begin(); it != idleClients.end(); ++it) {
+    if ((*it)->getPeerAddress() == address) {
+      NimBLEClient* client = *it;
+      idleClients.erase(it);
+      stats.reusedSamePeer++;
+      keepAttributes = true;
+      return client;
+    }
+  }
+
+  if (!idleClients.empty()) {
+    NimBLEClient* client = idleClients.back();
+    idleClients.pop_back();
+    client->setPeerAddress(address);
+    stats.reusedOtherPeer++;
+    return client;
+  }
+
+  NimBLEClient* client = NimBLEDevice::createClient(address);
+  if (client != nullptr) {
+    stats.created++;
+  }
+  return client;
+}
+
+void RemoteScalesClientPool::release(NimBLEClient* client) {
+  // The scales that used the client may be gone by the time it connects again.
+  client->setClientCallbacks(nullptr, false);
+  client->setConnectionParams(DEFAULT_MIN_INTERVAL, DEFAULT_MAX_INTERVAL, DEFAULT_LATENCY, DEFAULT_SUPERVISION_TIMEOUT);
+  if (client->isConnected()) {
+    client->disconnect();
+    uint32_t start = millis();
+    while (client->isConnected() && millis() - start < DISCONNECT_WAIT_MS) {
+      delay(1);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (client->isConnected()) {
+    // deleteClient() waits for the disconnect however long it takes.
+    NimBLEDevice::deleteClient(client);
+    stats.deleted++;
+    return;
+  }
+  idleClients.push_back(client);
+}
+
+void RemoteScalesClientPool::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (NimBLEClient* client : idleClients) {
+    NimBLEDevice::deleteClient(client);
+  }
+  idleClients.clear();
+}
+
+ClientPoolStats RemoteScalesClientPool::getStats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  ClientPoolStats current = stats;
+  current.idle = idleClients.size();
+  return current;
+}
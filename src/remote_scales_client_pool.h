@@ -0,0 +1,54 @@
+#pragma once
+#include <NimBLEDevice.h>
+#include <Arduino.h>
+#include <vector>
+#include <mutex>
+
+struct ClientPoolStats {
+  uint32_t created = 0;
+  uint32_t reusedSamePeer = 0;   // Reconnects that kept the discovered services
+  uint32_t reusedOtherPeer = 0;
+  uint32_t deleted = 0;          // Clients that didn't disconnect in time when released
+  uint32_t idle = 0;
+};
+
+// Keeps disconnected NimBLE clients for the next connect instead of deleting them, so reconnecting
+// doesn't free and allocate a client and its attribute tree every time. A client goes back to the scales
+// it was last connected to when possible, with the services it discovered then.
+class RemoteScalesClientPool {
+public:
+  static constexpr uint32_t DISCONNECT_WAIT_MS = 500;
+  // What NimBLE gives a new client: 30-50ms interval, no latency, 2.56s supervision timeout.
+  static constexpr uint16_t DEFAULT_MIN_INTERVAL = 24;
+  static constexpr uint16_t DEFAULT_MAX_INTERVAL = 40;
+  static constexpr uint16_t DEFAULT_LATENCY = 0;
+  static constexpr uint16_t DEFAULT_SUPERVISION_TIMEOUT = 256;
+
+  // keepAttributes is set when the client was last connected to this address, so connect() can skip
+  // discovering the services again. Returns nullptr when NimBLE has no client left.
+  NimBLEClient* acquire(const NimBLEAddress& address, bool& keepAttributes);
+  // Disconnects the client if needed and puts back NimBLE's default connection parameters, so the next
+  // scales don't inherit a link profile. Don't call from the BLE host task, it waits for the disconnect.
+  void release(NimBLEClient* client);
+  // Deletes the idle clients, i.e. before NimBLEDevice::deinit().
+  void clear();
+  ClientPoolStats getStats();
+
+  static RemoteScalesClientPool* getInstance() {
+    if (instance == nullptr) {
+      instance = new RemoteScalesClientPool();
+    }
+    return instance;
+  }
+
+  RemoteScalesClientPool(RemoteScalesClientPool& other) = delete;
+  void operator=(const RemoteScalesClientPool&) = delete;
+
+private:
+  static RemoteScalesClientPool* instance;
+  RemoteScalesClientPool() {}  // Private constructor to enforce singleton
+
+  std::mutex mutex;
+  std::vector<NimBLEClient*> idleClients;
+  ClientPoolStats stats;
+};
@@ -25,10 +25,24 @@ bool RemoteScalesPluginRegistry::containsPluginForDevice(const DiscoveredDevice&
   return false;
 }
 
+const RemoteScalesPlugin* RemoteScalesPluginRegistry::getPluginForDevice(const DiscoveredDevice& device) {
+  for (const auto& plugin : plugins) {
+    if (plugin.handles(device)) {
+      return &plugin;
+    }
+  }
+  return nullptr;
+}
+
 std::unique_ptr<RemoteScales> RemoteScalesPluginRegistry::initialiseRemoteScales(const DiscoveredDevice& device) {
   for (const auto& plugin : plugins) {
     if (plugin.handles(device)) {
-      return plugin.initialise(device);
+      std::unique_ptr<RemoteScales> scales = plugin.initialise(device);
+      if (scales != nullptr) {
+        scales->pluginId = plugin.id;
+        scales->setLinkProfile(plugin.linkProfile);
+      }
+      return scales;
     }
   }
   return nullptr;
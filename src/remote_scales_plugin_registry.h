@@ -7,6 +7,7 @@ struct RemoteScalesPlugin {
   std::string id;
   RemoteScalesFilter handles;
   RemoteScalesInitialiser initialise;
+  LinkProfile linkProfile = {};
 };
 
 class RemoteScalesPluginRegistry {
@@ -23,6 +24,7 @@ public:
 
   void registerPlugin(RemoteScalesPlugin plugin);
   bool containsPluginForDevice(const DiscoveredDevice& device);
+  const RemoteScalesPlugin* getPluginForDevice(const DiscoveredDevice& device);
   std::unique_ptr<RemoteScales> initialiseRemoteScales(const DiscoveredDevice& device);
 
 private:
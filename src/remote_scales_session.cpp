@@ -0,0 +1,80 @@
+#include "remote_scales_session.h"
+
+// ---------------------------------------------------------------------------------------
+// ------------------------   RemoteScalesSessionManager    ------------------------------
+// ---------------------------------------------------------------------------------------
+
+RemoteScalesSessionManager::~RemoteScalesSessionManager() {
+  for (ScaleId scaleId = 0; scaleId < MAX_SCALES; scaleId++) {
+    removeScales(scaleId);
+  }
+}
+
+ScaleId RemoteScalesSessionManager::addScales(std::unique_ptr<RemoteScales> scales) {
+  if (scales == nullptr) {
+    return INVALID_SCALE_ID;
+  }
+  for (ScaleId scaleId = 0; scaleId < MAX_SCALES; scaleId++) {
+    Slot& slot = slots[scaleId];
+    if (slot.scales != nullptr) {
+      continue;
+    }
+    slot.sampleListenerId = scales->addSampleListener([this, scaleId](const WeightSample& sample) {
+      samples.push(TaggedWeightSample{ .scaleId = scaleId, .weightMg = sample.weightMg, .timestamp = sample.timestamp });
+    });
+    slot.scales = std::move(scales);
+    return scaleId;
+  }
+  return INVALID_SCALE_ID;
+}
+
+std::unique_ptr<RemoteScales> RemoteScalesSessionManager::removeScales(ScaleId scaleId) {
+  if (scaleId >= MAX_SCALES || slots[scaleId].scales == nullptr) {
+    return nullptr;
+  }
+  Slot& slot = slots[scaleId];
+  slot.scales->removeSampleListener(slot.sampleListenerId);
+  return std::move(slot.scales);
+}
+
+RemoteScales* RemoteScalesSessionManager::getScales(ScaleId scaleId) {
+  return scaleId < MAX_SCALES ? slots[scaleId].scales.get() : nullptr;
+}
+
+size_t RemoteScalesSessionManager::size() const {
+  size_t count = 0;
+  for (const auto& slot : slots) {
+    if (slot.scales != nullptr) count++;
+  }
+  return count;
+}
+
+void RemoteScalesSessionManager::update() {
+  uint32_t startedAt = millis();
+  for (size_t i = 0; i < MAX_SCALES; i++) {
+    Slot& slot = slots[nextToUpdate];
+    nextToUpdate = (nextToUpdate + 1) % MAX_SCALES;
+    if (slot.scales == nullptr) {
+      continue;
+    }
+    slot.scales->update();
+    if (millis() - startedAt >= updateBudgetMs) {
+      break;
+    }
+  }
+}
+
+float RemoteScalesSessionManager::getWeight(ScaleId scaleId) {
+  RemoteScales* scales = getScales(scaleId);
+  return scales != nullptr ? scales->getWeight() : 0.f;
+}
+
+int32_t RemoteScalesSessionManager::getTotalWeightMilligrams() {
+  int32_t totalMg = 0;
+  for (const auto& slot : slots) {
+    if (slot.scales != nullptr && slot.scales->isConnected()) {
+      totalMg += slot.scales->getWeightMilligrams();
+    }
+  }
+  return totalMg;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "remote_scales.h"
+#include "spsc_ring_buffer.h"
+#include <array>
+
+using ScaleId = uint8_t;
+
+struct TaggedWeightSample {
+  ScaleId scaleId;
+  int32_t weightMg;
+  uint32_t timestamp;
+
+  float getWeight() const { return weightMg / 1000.f; }
+};
+
+// Owns several connected scales, i.e. one under the cup and one under the dripper.
+// Their samples are merged into a single stream. All notifications are delivered by the one BLE host
+// task, so the merged stream is in timestamp order without having to sort it.
+// Note that NimBLE only allows CONFIG_BT_NIMBLE_MAX_CONNECTIONS (3 by default) links at the same time.
+class RemoteScalesSessionManager {
+public:
+  static constexpr size_t MAX_SCALES = 4;
+  static constexpr ScaleId INVALID_SCALE_ID = 0xFF;
+
+  ~RemoteScalesSessionManager();
+
+  // Returns INVALID_SCALE_ID if all slots are taken.
+  ScaleId addScales(std::unique_ptr<RemoteScales> scales);
+  std::unique_ptr<RemoteScales> removeScales(ScaleId scaleId);
+  RemoteScales* getScales(ScaleId scaleId);
+  size_t size() const;
+
+  // Runs the update() of each scale in turn, which fires only that scale's timers. Once updateBudgetMs is
+  // used up the remaining scales are updated on the next call. A scale blocking on a write still delays
+  // the ones after it within this call, but never more than that one update().
+  void update();
+  void setUpdateBudget(uint32_t budgetMs) { updateBudgetMs = budgetMs; }
+
+  // Takes the oldest sample from the merged stream. Returns false if there is none.
+  bool pollSample(TaggedWeightSample& sample) { return samples.pop(sample); }
+  size_t getDroppedSamples() const { return samples.getDropped(); }
+
+  float getWeight(ScaleId scaleId);
+  float getTotalWeight() { return getTotalWeightMilligrams() / 1000.f; }
+  int32_t getTotalWeightMilligrams();
+
+private:
+  struct Slot {
+    std::unique_ptr<RemoteScales> scales;
+    size_t sampleListenerId;
+  };
+
+  std::array<Slot, MAX_SCALES> slots;
+  SpscRingBuffer<TaggedWeightSample, 64> samples;
+  ScaleId nextToUpdate = 0;
+  uint32_t updateBudgetMs = 5;
+};
@@ -0,0 +1,123 @@
+#include "remote_scales_task.h"
+#include <algorithm>
+
+RemoteScalesTask* RemoteScalesTask::instance = nullptr;
+
+// ---------------------------------------------------------------------------------------
+// ------------------------------   RemoteScalesTask    ----------------------------------
+// ---------------------------------------------------------------------------------------
+
+bool RemoteScalesTask::begin(ScaleTaskConfig config) {
+  if (running) {
+    return true;
+  }
+  this->config = config;
+  running = true;
+
+#ifdef ESP_PLATFORM
+  stopped = xSemaphoreCreateBinary();
+  BaseType_t core = config.core < 0 ? tskNO_AFFINITY : config.core;
+  if (xTaskCreatePinnedToCore(&RemoteScalesTask::taskMain, "remote_scales", config.stackSize, this, config.priority, &taskHandle, core) != pdPASS) {
+    vSemaphoreDelete(stopped);
+    stopped = nullptr;
+    running = false;
+    return false;
+  }
+#else
+  thread = std::thread([this]() { run(); });
+#endif
+  return true;
+}
+
+void RemoteScalesTask::end() {
+  if (!running) {
+    return;
+  }
+  running = false;
+  wake();
+
+#ifdef ESP_PLATFORM
+  xSemaphoreTake(stopped, portMAX_DELAY);
+  vSemaphoreDelete(stopped);
+  stopped = nullptr;
+  taskHandle = nullptr;
+#else
+  thread.join();
+#endif
+}
+
+void RemoteScalesTask::addScales(RemoteScales* scales) {
+  {
+    std::lock_guard<std::mutex> lock(scalesMutex);
+    if (std::find(this->scales.begin(), this->scales.end(), scales) == this->scales.end()) {
+      this->scales.push_back(scales);
+    }
+  }
+  scales->task = this;
+  wake();
+}
+
+void RemoteScalesTask::removeScales(RemoteScales* scales) {
+  scales->task = nullptr;
+  std::lock_guard<std::mutex> lock(scalesMutex);
+  this->scales.erase(std::remove(this->scales.begin(), this->scales.end(), scales), this->scales.end());
+}
+
+void RemoteScalesTask::wake() {
+#ifdef ESP_PLATFORM
+  TaskHandle_t handle = taskHandle;
+  if (handle != nullptr) {
+    xTaskNotifyGive(handle);
+  }
+#else
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    wakeRequested = true;
+  }
+  wakeCondition.notify_one();
+#endif
+}
+
+#ifdef ESP_PLATFORM
+void RemoteScalesTask::taskMain(void* parameter) {
+  RemoteScalesTask* task = static_cast<RemoteScalesTask*>(parameter);
+  task->run();
+  xSemaphoreGive(task->stopped);
+  vTaskDelete(nullptr);
+}
+#endif
+
+void RemoteScalesTask::run() {
+  while (running) {
+    runPass();
+    waitForWake(sleepDuration());
+  }
+}
+
+void RemoteScalesTask::runPass() {
+  std::lock_guard<std::mutex> lock(scalesMutex);
+  for (RemoteScales* scales : this->scales) {
+    if (scales->getCallbackExecutor() == CallbackExecutor::SCALE_TASK) {
+      scales->runCallbacks();
+    }
+    scales->update();
+  }
+}
+
+uint32_t RemoteScalesTask::sleepDuration() {
+  std::optional<uint32_t> nextDeadline = RemoteScalesTimerWheel::getInstance()->getMillisUntilNextDeadline();
+  return nextDeadline ? std::min(*nextDeadline, config.maxIdleMs) : config.maxIdleMs;
+}
+
+void RemoteScalesTask::waitForWake(uint32_t timeoutMs) {
+  if (timeoutMs == 0) {
+    return;
+  }
+#ifdef ESP_PLATFORM
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+#else
+  std::unique_lock<std::mutex> lock(wakeMutex);
+  wakeCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return wakeRequested; });
+  wakeRequested = false;
+#endif
+}
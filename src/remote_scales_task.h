@@ -0,0 +1,74 @@
+#pragma once
+#include "remote_scales.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#else
+#include <thread>
+#include <condition_variable>
+#endif
+
+struct ScaleTaskConfig {
+  uint32_t stackSize = 6144;
+  uint8_t priority = 1;
+  int core = -1;             // -1 lets FreeRTOS pick the core. Ignored on the host build.
+  uint32_t maxIdleMs = 1000; // Drivers that still check their connection in update() get called at least this often.
+};
+
+// Runs the housekeeping of the added scales on a dedicated FreeRTOS task (a std::thread on the host build),
+// so it no longer depends on how often the application's loop calls update(). The task sleeps until
+// the next timer deadline and is woken early by BLE events that need attention, i.e. a lost connection.
+// Don't call update() of the added scales yourself.
+class RemoteScalesTask {
+public:
+  bool begin(ScaleTaskConfig config = ScaleTaskConfig());
+  // Blocks until the task has finished its current pass.
+  void end();
+  bool isRunning() const { return running; }
+
+  // The scales must be removed again before they are destroyed.
+  void addScales(RemoteScales* scales);
+  void removeScales(RemoteScales* scales);
+
+  // Safe to call from any task.
+  void wake();
+
+  static RemoteScalesTask* getInstance() {
+    if (instance == nullptr) {
+      instance = new RemoteScalesTask();
+    }
+    return instance;
+  }
+
+  RemoteScalesTask(RemoteScalesTask& other) = delete;
+  void operator=(const RemoteScalesTask&) = delete;
+
+private:
+  static RemoteScalesTask* instance;
+  RemoteScalesTask() {}  // Private constructor to enforce singleton
+
+  ScaleTaskConfig config;
+  std::atomic<bool> running{ false };
+  std::mutex scalesMutex;  // Held during a pass, so removeScales() waits for it to finish
+  std::vector<RemoteScales*> scales;
+
+#ifdef ESP_PLATFORM
+  TaskHandle_t taskHandle = nullptr;
+  SemaphoreHandle_t stopped = nullptr;
+  static void taskMain(void* parameter);
+#else
+  std::thread thread;
+  std::mutex wakeMutex;
+  std::condition_variable wakeCondition;
+  bool wakeRequested = false;
+#endif
+
+  void run();
+  void runPass();
+  uint32_t sleepDuration();
+  void waitForWake(uint32_t timeoutMs);
+};
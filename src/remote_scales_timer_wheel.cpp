@@ -0,0 +1,203 @@
+#include "remote_scales_timer_wheel.h"
+#include "remote_scales.h"
+#include <algorithm>
+
+RemoteScalesTimerWheel* RemoteScalesTimerWheel::instance = nullptr;
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   RemoteScalesTimerWheel    -------------------------------
+// ---------------------------------------------------------------------------------------
+
+void RemoteScalesTimerWheel::schedule(RemoteScales* scales, ScaleTimer timer, uint32_t delayMs, uint32_t periodMs) {
+  uint32_t now = millis();
+  std::lock_guard<std::mutex> lock(mutex);
+  Owner* owner = findOwnerLocked(scales);
+  if (owner == nullptr) {
+    owners.push_back(std::make_unique<Owner>());
+    owner = owners.back().get();
+    owner->scales = scales;
+  }
+  removeLocked(*owner, timer);
+  if (owner->count == 0) {
+    owner->lastTick = now / TICK_MS;
+  }
+
+  uint32_t deadline = now + delayMs;
+  slots[slotFor(deadline)].push_back(Entry{ scales, timer, deadline, periodMs, nextId++ });
+  owner->count++;
+  count++;
+}
+
+void RemoteScalesTimerWheel::cancel(RemoteScales* scales, ScaleTimer timer) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Owner* owner = findOwnerLocked(scales);
+  if (owner != nullptr) {
+    removeLocked(*owner, timer);
+  }
+}
+
+void RemoteScalesTimerWheel::cancelAll(RemoteScales* scales) {
+  Owner* owner;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    owner = findOwnerLocked(scales);
+    if (owner == nullptr) {
+      return;
+    }
+  }
+  // Owners are only removed by remove(), from the destructor of their scales.
+  std::lock_guard<std::recursive_mutex> dispatchLock(owner->dispatchMutex);
+  std::lock_guard<std::mutex> lock(mutex);
+  for (size_t i = 0; i < SCALE_TIMER_COUNT; i++) {
+    removeLocked(*owner, static_cast<ScaleTimer>(i));
+  }
+}
+
+void RemoteScalesTimerWheel::remove(RemoteScales* scales) {
+  cancelAll(scales);
+  std::unique_ptr<Owner> removed;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = std::find_if(owners.begin(), owners.end(), [=](const std::unique_ptr<Owner>& owner) { return owner->scales == scales; });
+  if (it != owners.end()) {
+    removed = std::move(*it);
+    owners.erase(it);
+  }
+}
+
+bool RemoteScalesTimerWheel::isScheduled(RemoteScales* scales, ScaleTimer timer) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto& slot : slots) {
+    for (const auto& entry : slot) {
+      if (entry.scales == scales && entry.timer == timer) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void RemoteScalesTimerWheel::update(RemoteScales* scales) {
+  Owner* owner;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    owner = findOwnerLocked(scales);
+    if (owner == nullptr) {
+      return;
+    }
+  }
+  std::lock_guard<std::recursive_mutex> dispatchLock(owner->dispatchMutex);
+  uint32_t now = millis();
+  std::vector<Entry> due;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (owner->count == 0) {
+      return;
+    }
+
+    // The slot of lastTick is visited again, it may hold timers due later within that tick.
+    uint32_t currentTick = now / TICK_MS;
+    size_t slotsToVisit = std::min<uint32_t>(currentTick - owner->lastTick + 1, SLOT_COUNT);
+    owner->lastTick = currentTick;
+
+    std::vector<Entry> rearmed;
+    for (size_t i = 0; i < slotsToVisit; i++) {
+      auto& slot = slots[(currentTick - i) % SLOT_COUNT];
+      for (size_t j = 0; j < slot.size();) {
+        // Timers of other scales, and those further than a revolution away, wait for their turn.
+        if (slot[j].scales != scales || static_cast<int32_t>(now - slot[j].deadline) < 0) {
+          j++;
+          continue;
+        }
+        Entry entry = slot[j];
+        slot[j] = slot.back();
+        slot.pop_back();
+        due.push_back(entry);
+        firing.push_back(entry);
+        if (entry.periodMs > 0) {
+          // Keep the period steady, unless update() fell so far behind that the next deadline already passed.
+          entry.deadline += entry.periodMs;
+          if (static_cast<int32_t>(now - entry.deadline) >= 0) {
+            entry.deadline = now + entry.periodMs;
+          }
+          rearmed.push_back(entry);
+        }
+        else {
+          owner->count--;
+          count--;
+        }
+      }
+    }
+    for (const auto& entry : rearmed) {
+      slots[slotFor(entry.deadline)].push_back(entry);
+    }
+  }
+
+  // The slots were visited newest first, fire the timers in the order they were due.
+  std::stable_sort(due.begin(), due.end(), [=](const Entry& a, const Entry& b) {
+    return static_cast<int32_t>(a.deadline - now) < static_cast<int32_t>(b.deadline - now);
+  });
+  for (const Entry& dueEntry : due) {
+    uint32_t id = dueEntry.id;
+    std::optional<Entry> entry;
+    {
+      // An earlier timer may have cancelled this one from its callback, removing it from firing.
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = std::find_if(firing.begin(), firing.end(), [=](const Entry& firingEntry) { return firingEntry.id == id; });
+      if (it == firing.end()) {
+        continue;
+      }
+      entry = *it;
+      firing.erase(it);
+    }
+    entry->scales->handleTimer(entry->timer);
+  }
+}
+
+std::optional<uint32_t> RemoteScalesTimerWheel::getMillisUntilNextDeadline() {
+  uint32_t now = millis();
+  std::lock_guard<std::mutex> lock(mutex);
+  std::optional<uint32_t> next;
+  for (const auto& slot : slots) {
+    for (const auto& entry : slot) {
+      int32_t remaining = static_cast<int32_t>(entry.deadline - now);
+      uint32_t wait = remaining > 0 ? remaining : 0;
+      if (!next || wait < *next) {
+        next = wait;
+      }
+    }
+  }
+  return next;
+}
+
+size_t RemoteScalesTimerWheel::size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return count;
+}
+
+RemoteScalesTimerWheel::Owner* RemoteScalesTimerWheel::findOwnerLocked(RemoteScales* scales) {
+  for (auto& owner : owners) {
+    if (owner->scales == scales) {
+      return owner.get();
+    }
+  }
+  return nullptr;
+}
+
+bool RemoteScalesTimerWheel::removeLocked(Owner& owner, ScaleTimer timer) {
+  firing.erase(
+    std::remove_if(firing.begin(), firing.end(), [&](const Entry& entry) { return entry.scales == owner.scales && entry.timer == timer; }),
+    firing.end()
+  );
+  for (auto& slot : slots) {
+    for (size_t i = 0; i < slot.size(); i++) {
+      if (slot[i].scales == owner.scales && slot[i].timer == timer) {
+        slot[i] = slot.back();
+        slot.pop_back();
+        owner.count--;
+        count--;
+        return true;
+      }
+    }
+  }
+  return false;
+}
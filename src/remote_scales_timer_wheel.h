@@ -0,0 +1,87 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+#include <mutex>
+#include <optional>
+#include <memory>
+
+class RemoteScales;
+
+enum class ScaleTimer : uint8_t {
+  HEARTBEAT,  // Keeps the connection alive on scales that drop quiet clients.
+  WATCHDOG,   // Checks that a connected scale is still sending data. Handled by RemoteScales itself.
+  RECONNECT,  // Retries a lost connection. Handled by RemoteScales itself.
+  TARE,       // Fails a tareAsync() that wasn't confirmed in time. Handled by RemoteScales itself.
+  HANDSHAKE,  // Wakes update() for the next step of a handshake. Handled by RemoteScales itself.
+};
+constexpr size_t SCALE_TIMER_COUNT = 5;
+
+// Plans the timers of every scale in one place, so their drivers don't need to poll millis().
+// Timers are hashed by deadline into SLOT_COUNT slots of TICK_MS each, and update() only looks at the
+// slots of the ticks that passed since it last ran for those scales. The main loop can sleep for
+// getMillisUntilNextDeadline() instead of calling update() as often as it can.
+class RemoteScalesTimerWheel {
+public:
+  static constexpr uint32_t TICK_MS = 50;
+  static constexpr size_t SLOT_COUNT = 64;
+
+  // Replaces the timer if it is already scheduled. A periodMs of 0 fires the timer only once.
+  void schedule(RemoteScales* scales, ScaleTimer timer, uint32_t delayMs, uint32_t periodMs = 0);
+  void cancel(RemoteScales* scales, ScaleTimer timer);
+  // Once this returns, none of the timers of these scales is firing or will fire.
+  void cancelAll(RemoteScales* scales);
+  // Cancels everything and forgets the scales, before they are destroyed.
+  void remove(RemoteScales* scales);
+  bool isScheduled(RemoteScales* scales, ScaleTimer timer);
+
+  // Fires the due timers of these scales only. Every scale's update() runs its own, so a timer that blocks,
+  // i.e. a heartbeat written with response, holds up its own scales and not the others.
+  void update(RemoteScales* scales);
+  // How long update() has nothing to do. Empty when no timer is scheduled.
+  std::optional<uint32_t> getMillisUntilNextDeadline();
+  size_t size();
+
+  static RemoteScalesTimerWheel* getInstance() {
+    if (instance == nullptr) {
+      instance = new RemoteScalesTimerWheel();
+    }
+    return instance;
+  }
+
+  RemoteScalesTimerWheel(RemoteScalesTimerWheel& other) = delete;
+  void operator=(const RemoteScalesTimerWheel&) = delete;
+
+private:
+  struct Entry {
+    RemoteScales* scales;
+    ScaleTimer timer;
+    uint32_t deadline;
+    uint32_t periodMs;
+    uint32_t id;
+  };
+
+  // The scales that have timers, each dispatched on its own.
+  struct Owner {
+    RemoteScales* scales;
+    // Held while the timers of these scales fire, which lets cancelAll() wait for them, and
+    // recursive so timers can cancel from their own callback.
+    std::recursive_mutex dispatchMutex;
+    uint32_t lastTick = 0;
+    size_t count = 0;
+  };
+
+  static RemoteScalesTimerWheel* instance;
+  RemoteScalesTimerWheel() {}  // Private constructor to enforce singleton
+
+  // Lock order is an owner's dispatchMutex, then mutex.
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Owner>> owners;
+  std::vector<Entry> slots[SLOT_COUNT];
+  std::vector<Entry> firing;  // Due timers whose callback hasn't run yet
+  size_t count = 0;
+  uint32_t nextId = 0;
+
+  static size_t slotFor(uint32_t deadline) { return (deadline / TICK_MS) % SLOT_COUNT; }
+  Owner* findOwnerLocked(RemoteScales* scales);
+  bool removeLocked(Owner& owner, ScaleTimer timer);
+};
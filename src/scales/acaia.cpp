@@ -55,7 +55,23 @@ const NimBLEUUID umbraWeightCharacteristicUUID("0000fe42-8e22-4541-9d4c-21edae82
 //-----------------------------------------------------------------------------------/
 //---------------------------        PUBLIC       -----------------------------------/
 //-----------------------------------------------------------------------------------/
-AcaiaScales::AcaiaScales(const DiscoveredDevice& device) : RemoteScales(device) {}
+AcaiaScales::AcaiaScales(const DiscoveredDevice& device) : RemoteScales(device) {
+  setTimerInterval(ScaleTimer::HEARTBEAT, 2000);
+  setKeepalivePolicy(KeepalivePolicy::ADAPTIVE);
+  // The scale parses commands from a stream of frames, so several can share a write.
+  setWriteBatching(true);
+  setTimerInterval(ScaleTimer::WATCHDOG, 1500);
+
+  // Runs from update() after connect() returns, see RemoteScales::startHandshake().
+  handshake.addAction("service discovery", [this]() { return findCharacteristics(); });
+  handshake.addAction("subscribe", [this]() { return subscribe(); });
+  handshake.addAction("identify", [this]() { identify(); return true; });
+  // The scale answers the notification request with its status and weight events.
+  handshake.addNotificationWait("first message", [](const uint8_t* message, size_t length) {
+    AcaiaMessageType messageType = static_cast<AcaiaMessageType>(message[2]);
+    return messageType == AcaiaMessageType::EVENT || messageType == AcaiaMessageType::STATUS;
+  }, HANDSHAKE_TIMEOUT_MS);
+}
 
 bool AcaiaScales::connect() {
   if (RemoteScales::clientIsConnected()) {
@@ -70,12 +86,9 @@ bool AcaiaScales::connect() {
     return false;
   }
 
-  if (!performConnectionHandshake()) {
-    return false;
-  }
-  subscribeToNotifications();
-  RemoteScales::setWeight(0.f);
-  return true;
+  RemoteScales::resetWeight();
+  RemoteScales::log("Performing handshake\n");
+  return RemoteScales::startHandshake();
 }
 
 void AcaiaScales::disconnect() {
@@ -83,19 +96,11 @@ void AcaiaScales::disconnect() {
 }
 
 bool AcaiaScales::isConnected() {
-  return RemoteScales::clientIsConnected();
+  return RemoteScales::clientIsConnected() && !RemoteScales::isHandshaking();
 }
 
 void AcaiaScales::update() {
-  if (markedForReconnection) {
-    RemoteScales::log("Marked for disconnection. Will attempt to reconnect.\n");
-    RemoteScales::clientCleanup();
-    connect();
-    markedForReconnection = false;
-  }
-  else {
-    sendHeartbeat();
-  }
+  runTimers();
 }
 
 bool AcaiaScales::tare() {
@@ -150,6 +155,7 @@ bool AcaiaScales::decodeAndHandleNotification() {
   }
 
   AcaiaMessageType messageType = static_cast<AcaiaMessageType>(dataBuffer[2]);
+  RemoteScales::feedHandshake(dataBuffer.data(), messageLength);
 
   if (messageType == AcaiaMessageType::EVENT) {
     handleScaleEventPayload(payload, payloadLength);
@@ -163,8 +169,8 @@ bool AcaiaScales::decodeAndHandleNotification() {
     // For some reason, Acaia Pearl S sends this info message upon connection.
     // It can safely be ignored; otherwise, the scale will almost never successfully connect.
     if(RemoteScales::getDeviceName().find("PEARLS")!=0){
-      // This normally means that something went wrong with the establishing a connection so we disconnect.
-      markedForReconnection = true;
+      // This normally means that something went wrong with the establishing a connection so we reconnect.
+      RemoteScales::requestReconnect();
     }
 
   }
@@ -180,7 +186,9 @@ bool AcaiaScales::decodeAndHandleNotification() {
 void AcaiaScales::handleScaleEventPayload(const uint8_t* payload, size_t length) {
   AcaiaEventType eventType = static_cast<AcaiaEventType>(payload[1]);
   if (eventType == AcaiaEventType::WEIGHT) {
-    RemoteScales::setWeight(decodeWeight(payload + 2));
+    if (int32_t weightMg; decodeWeight(payload + 2, weightMg)) {
+      RemoteScales::setWeightMilligrams(weightMg);
+    }
   }
   else if (eventType == AcaiaEventType::ACK) {
     // Ignore for now.
@@ -196,7 +204,11 @@ void AcaiaScales::handleScaleEventPayload(const uint8_t* payload, size_t length)
     // RemoteScales::log("Time:  %0.1f\n", time);
   }
   else if (eventType == AcaiaEventType::KEY) {
-    // Ignore for now
+    // The scale reports the tare button, and the tare command, as key 0x00 with action 0x05 (0x01 on older firmware).
+    if (length >= 5 && payload[2] == 0x00 && (payload[4] == 0x05 || payload[4] == 0x01)) {
+      RemoteScales::confirmTare();
+    }
+    // Other keys are ignored for now
     // AcaiaEventKey eventKey = static_cast<AcaiaEventKey>(payload[1]);
     // if (eventKey == AcaiaEventKey::TARE) {
     //   RemoteScales::setWeight(decodeWeight(payload + 2));
@@ -232,22 +244,22 @@ void AcaiaScales::handleScaleEventPayload(const uint8_t* payload, size_t length)
 }
 
 void AcaiaScales::handleScaleStatusPayload(const uint8_t* payload, size_t length) {
-  battery = payload[1] & 0x7F;
+  RemoteScales::setBattery(payload[1] & 0x7F);
   if (payload[2] == 2) {
-    weightUnits = "grams";
+    RemoteScales::setWeightUnit(WeightUnit::GRAMS);
   }
   else if (payload[2] == 5) {
-    weightUnits = "ounces";
+    RemoteScales::setWeightUnit(WeightUnit::OUNCES);
   }
   else {
-    weightUnits = "";
+    RemoteScales::setWeightUnit(WeightUnit::UNKNOWN);
   }
   // uint8_t auto_off = payload[4] * 5;
   // bool beep_on = (payload[6] == 1);
 }
 
-float AcaiaScales::decodeWeight(const uint8_t* weightPayload) {
-  float value;
+bool AcaiaScales::decodeWeight(const uint8_t* weightPayload, int32_t& weightMg) {
+  int32_t value;
   uint8_t scaling;
 
   // Umbra scales use different byte positions for weight data
@@ -261,38 +273,38 @@ float AcaiaScales::decodeWeight(const uint8_t* weightPayload) {
     scaling = weightPayload[4];
   }
 
+  // Scaling is the number of decimals of the value in grams.
   switch (scaling) {
   case 1:
-    value /= 10.0f;
+    value *= 100;
     break;
   case 2:
-    value /= 100.0f;
+    value *= 10;
     break;
   case 3:
-    value /= 1000.0f;
     break;
   case 4:
-    value /= 10000.0f;
+    value = (value + 5) / 10;
     break;
   default:
     RemoteScales::log("Invalid scaling %02X - %s \n", scaling, RemoteScales::byteArrayToHexString(weightPayload, 6).c_str());
-    return -1;
+    return false;
   }
+  RemoteScales::setDecimals(scaling);
 
   if (weightPayload[5] & 0x02) {
-    value *= -1.0f;
+    value = -value;
   }
 
-  return value;
+  weightMg = value;
+  return true;
 }
 
 float AcaiaScales::decodeTime(const uint8_t* timePayload) {
   return timePayload[0] * 60.0f + timePayload[1] + timePayload[2] / 10.0f;
 }
 
-bool AcaiaScales::performConnectionHandshake() {
-  RemoteScales::log("Performing handshake\n");
-
+bool AcaiaScales::findCharacteristics() {
   if (RemoteScales::clientGetService(oldServiceUUID)) {
     service = RemoteScales::clientGetService(oldServiceUUID);
   }
@@ -304,9 +316,9 @@ bool AcaiaScales::performConnectionHandshake() {
   }
   else {
     RemoteScales::log("No compatible service found\n");
-    clientCleanup();
     return false;
   }
+  RemoteScales::markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
 
   if (service->getUUID().equals(umbraServiceUUID)) {
     // Umbra fe40 service uses fe41 for commands, fe42 for weight notifications
@@ -324,30 +336,35 @@ bool AcaiaScales::performConnectionHandshake() {
 
   if (weightCharacteristic == nullptr || commandCharacteristic == nullptr) {
     RemoteScales::log("Failed to find required characteristics\n");
-    clientCleanup();
     return false;
   }
   RemoteScales::log("Got weightCharacteristic and commandCharacteristic\n");
+  RemoteScales::markConnectPhase(ConnectPhase::CHARACTERISTICS);
+  return true;
+}
 
-  // Subscribe to notifications
+// The callbacks are registered before identifying, the handshake waits for the scale's answer.
+bool AcaiaScales::subscribe() {
   NimBLERemoteDescriptor* notifyDescriptor = weightCharacteristic->getDescriptor(NimBLEUUID((uint16_t)0x2902));
   RemoteScales::log("Got notifyDescriptor\n");
-  if (notifyDescriptor != nullptr) {
-    uint8_t value[2] = { 0x01, 0x00 };
-    notifyDescriptor->writeValue(value, 2, true);
-  }
-  else {
-    clientCleanup();
+  if (notifyDescriptor == nullptr) {
     return false;
   }
+  uint8_t value[2] = { 0x01, 0x00 };
+  notifyDescriptor->writeValue(value, 2, true);
+  subscribeToNotifications();
+  RemoteScales::markConnectPhase(ConnectPhase::SUBSCRIBE);
+  return true;
+}
 
-  // Identify
+void AcaiaScales::identify() {
+  RemoteScales::beginWriteBatch();
   sendId();
-  RemoteScales::log("Send ID\n");
   sendNotificationRequest();
-  RemoteScales::log("Sent notification request\n");
-  lastHeartbeat = millis();
-  return true;
+  RemoteScales::endWriteBatch();
+  RemoteScales::log("Sent ID and notification request\n");
+  RemoteScales::markConnectPhase(ConnectPhase::HANDSHAKE);
+  startTimer(ScaleTimer::HEARTBEAT);
 }
 
 void AcaiaScales::sendId() {
@@ -355,11 +372,38 @@ void AcaiaScales::sendId() {
   sendMessage(AcaiaMessageType::IDENTIFY, payload, 15, false);
 }
 
+// Pairs of event type and how many of the scale's updates to skip between notifications of it.
 void AcaiaScales::sendNotificationRequest() {
-  uint8_t payload[] = { 0, 1, 1, 2, 2, 5, 3, 4 };
+  uint8_t weightSkip = 1;
+  switch (RemoteScales::getStreamingProfile()) {
+  case StreamingProfile::MAX_RATE:
+    weightSkip = 0;
+    break;
+  case StreamingProfile::BALANCED:
+    weightSkip = 1;
+    break;
+  case StreamingProfile::LOW_POWER:
+    weightSkip = 5;
+    break;
+  }
+  uint8_t payload[] = { 0, weightSkip, 1, 2, 2, 5, 3, 4 };
   sendEvent(payload, 8);
 }
 
+void AcaiaScales::applyStreamingProfile(StreamingProfile profile) {
+  sendNotificationRequest();
+}
+
+// subscribe() rewrites the CCCD, which is what usually got lost when the scale stops notifying.
+bool AcaiaScales::resubscribe() {
+  if (!isConnected()) {
+    return false;
+  }
+  subscribeToNotifications();
+  sendNotificationRequest();
+  return true;
+}
+
 void AcaiaScales::sendEvent(const uint8_t* payload, size_t length) {
   auto bytes = std::make_unique<uint8_t[]>(length + 1);
   bytes[0] = static_cast<uint8_t>(length + 1);
@@ -376,17 +420,19 @@ void AcaiaScales::sendHeartbeat() {
     return;
   }
 
-  uint32_t now = millis();
-  if (now - lastHeartbeat < 2000) {
-    return;
-  }
-
+  RemoteScales::beginWriteBatch();
   uint8_t payload1[] = { 0x02,0x00 };
   sendMessage(AcaiaMessageType::SYSTEM, payload1, 2);
   sendNotificationRequest();
   uint8_t payload2[] = { 0x00 };
   sendMessage(AcaiaMessageType::HANDSHAKE, payload2, 1);
-  lastHeartbeat = now;
+  RemoteScales::endWriteBatch();
+}
+
+void AcaiaScales::onTimer(ScaleTimer timer) {
+  if (timer == ScaleTimer::HEARTBEAT) {
+    sendHeartbeat();
+  }
 }
 
 void AcaiaScales::subscribeToNotifications() {
@@ -424,7 +470,7 @@ void AcaiaScales::sendMessage(AcaiaMessageType msgType, const uint8_t* payload,
   bytes[length + 3] = (checksums.first & 0xFF);
   bytes[length + 4] = (checksums.second & 0xFF);
 
-  commandCharacteristic->writeValue(bytes.get(), messageSize, waitResponse);
+  RemoteScales::clientWrite(commandCharacteristic, bytes.get(), messageSize, waitResponse);
 };
 
 // Calculate the checksum for the payload of the message
@@ -29,13 +29,9 @@ public:
   bool tare() override;
 
 private:
-  std::string weightUnits;
   float time;
-  uint8_t battery;
 
-  uint32_t lastHeartbeat = 0;
 
-  bool markedForReconnection = false;
 
   NimBLERemoteService* service;
   NimBLERemoteCharacteristic* weightCharacteristic;
@@ -43,38 +39,33 @@ private:
 
   std::vector<uint8_t> dataBuffer;
 
-  bool performConnectionHandshake();
+  static constexpr uint32_t HANDSHAKE_TIMEOUT_MS = 2000;
+
+  // The steps of the handshake.
+  bool findCharacteristics();
+  bool subscribe();
+  void identify();
   void subscribeToNotifications();
 
   void sendMessage(AcaiaMessageType msgType, const uint8_t* payload, size_t length, bool waitResponse = false);
   void sendEvent(const uint8_t* payload, size_t length);
   void sendHeartbeat();
+  void onTimer(ScaleTimer timer) override;
+  void applyStreamingProfile(StreamingProfile profile) override;
+  bool resubscribe() override;
   void sendNotificationRequest();
   void sendId();
   void notifyCallback(NimBLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
   bool decodeAndHandleNotification();
   void handleScaleEventPayload(const uint8_t* pData, size_t length);
   void handleScaleStatusPayload(const uint8_t* pData, size_t length);
-  float decodeWeight(const uint8_t* weightPayload);
+  bool decodeWeight(const uint8_t* weightPayload, int32_t& weightMg);
   float decodeTime(const uint8_t* timePayload);
   
   // Helper to identify Umbra model scales which use slightly different BLE characteristics
   bool isUmbraModel() const;
 };
 
-class ScaleStatus {
-public:
-  ScaleStatus(uint8_t battery, const std::string& units, uint8_t auto_off, bool beep_on)
-    : battery(battery), units(units), auto_off(auto_off), beep_on(beep_on) {
-  }
-
-private:
-  uint8_t battery;
-  std::string units;
-  uint8_t auto_off;
-  bool beep_on;
-};
-
 class AcaiaScalesPlugin {
 public:
   static void apply() {
@@ -82,6 +73,8 @@ public:
       .id = "plugin-acaia",
       .handles = [](const DiscoveredDevice& device) { return AcaiaScalesPlugin::handles(device); },
       .initialise = [](const DiscoveredDevice& device) -> std::unique_ptr<RemoteScales> { return std::make_unique<AcaiaScales>(device); },
+      // Larger messages arrive split over several notifications at the default MTU.
+      .linkProfile = { .minInterval = 6, .maxInterval = 12, .latency = 0, .supervisionTimeout = 200, .mtu = 247 },
     };
     RemoteScalesPluginRegistry::getInstance()->registerPlugin(plugin);
   }
@@ -14,7 +14,11 @@ const NimBLEUUID commandCharacteristicUUID("FF12");
 //-----------------------------------------------------------------------------------/
 //---------------------------        PUBLIC       -----------------------------------/
 //-----------------------------------------------------------------------------------/
-BookooScales::BookooScales(const DiscoveredDevice& device) : RemoteScales(device) {}
+BookooScales::BookooScales(const DiscoveredDevice& device) : RemoteScales(device) {
+  setTimerInterval(ScaleTimer::HEARTBEAT, 2000);
+  setKeepalivePolicy(KeepalivePolicy::ADAPTIVE);
+  setTimerInterval(ScaleTimer::WATCHDOG, 1000);
+}
 
 bool BookooScales::connect() {
   if (RemoteScales::clientIsConnected()) {
@@ -33,7 +37,8 @@ bool BookooScales::connect() {
     return false;
   }
   subscribeToNotifications();
-  RemoteScales::setWeight(0.f);
+  RemoteScales::markConnectPhase(ConnectPhase::SUBSCRIBE);
+  RemoteScales::resetWeight();
   return true;
 }
 
@@ -46,16 +51,7 @@ bool BookooScales::isConnected() {
 }
 
 void BookooScales::update() {
-  if (markedForReconnection) {
-    RemoteScales::log("Marked for disconnection. Will attempt to reconnect.\n");
-    RemoteScales::clientCleanup();
-    connect();
-    markedForReconnection = false;
-  }
-  else {
-    sendHeartbeat();
-    RemoteScales::log("Heartbeat sent.\n");
-  }
+  runTimers();
 }
 
 bool BookooScales::tare() {
@@ -116,13 +112,13 @@ bool BookooScales::decodeAndHandleNotification() {
       return false;
     }
 
-    float weight = (dataBuffer[7] << 16) | (dataBuffer[8] << 8) | dataBuffer[9];
+    int32_t weight = (dataBuffer[7] << 16) | (dataBuffer[8] << 8) | dataBuffer[9];
 
     if (dataBuffer[6] == 45) { // Check if the value is negative
       weight = -weight;
     }
 
-    RemoteScales::setWeight(weight * 0.01f); // Convert to floating point
+    RemoteScales::setWeightMilligrams(weight * 10); // Convert from 0.01g
   }
   else if (productNumber == 0x03 && messageType == BookooMessageType::SYSTEM) {
     BookooScales::tare();
@@ -144,6 +140,7 @@ bool BookooScales::performConnectionHandshake() {
   service = RemoteScales::clientGetService(serviceUUID);
   if (service != nullptr) {
     RemoteScales::log("Got Service\n");
+    RemoteScales::markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
   }
   else {
     clientCleanup();
@@ -157,6 +154,7 @@ bool BookooScales::performConnectionHandshake() {
     return false;
   }
   RemoteScales::log("Got weightCharacteristic and commandCharacteristic\n");
+  RemoteScales::markConnectPhase(ConnectPhase::CHARACTERISTICS);
 
   // Subscribe
   NimBLERemoteDescriptor* notifyDescriptor = weightCharacteristic->getDescriptor(NimBLEUUID((uint16_t)0x2902));
@@ -164,6 +162,7 @@ bool BookooScales::performConnectionHandshake() {
   if (notifyDescriptor != nullptr) {
     uint8_t value[2] = { 0x00, 0x01 };
     notifyDescriptor->writeValue(value, 2, true);
+    RemoteScales::markConnectPhase(ConnectPhase::SUBSCRIBE);
   }
   else {
     clientCleanup();
@@ -172,7 +171,8 @@ bool BookooScales::performConnectionHandshake() {
 
   sendNotificationRequest();
   RemoteScales::log("Sent notification request\n");
-  lastHeartbeat = millis();
+  RemoteScales::markConnectPhase(ConnectPhase::HANDSHAKE);
+  startTimer(ScaleTimer::HEARTBEAT);
   return true;
 }
 
@@ -198,17 +198,26 @@ void BookooScales::sendHeartbeat() {
     return;
   }
 
-  uint32_t now = millis();
-  if (now - lastHeartbeat < 2000) {
-    return;
-  }
-
   uint8_t payload1[] = { 0x02,0x00 };
   sendMessage(BookooMessageType::SYSTEM, payload1, 2);
   sendNotificationRequest();
   uint8_t payload2[] = { 0x00 };
   sendMessage(BookooMessageType::SYSTEM, payload2, 1);
-  lastHeartbeat = now;
+}
+
+void BookooScales::onTimer(ScaleTimer timer) {
+  if (timer == ScaleTimer::HEARTBEAT) {
+    sendHeartbeat();
+  }
+}
+
+bool BookooScales::resubscribe() {
+  if (!isConnected()) {
+    return false;
+  }
+  subscribeToNotifications();
+  sendNotificationRequest();
+  return true;
 }
 
 void BookooScales::subscribeToNotifications() {
@@ -242,5 +251,5 @@ void BookooScales::sendMessage(BookooMessageType msgType, const uint8_t* payload
   }
   bytes[length - 1] = checksum;
 
-  commandCharacteristic->writeValue(bytes.get(), length, waitResponse);
+  clientWrite(commandCharacteristic, bytes.get(), length, waitResponse);
 }
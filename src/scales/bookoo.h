@@ -28,9 +28,7 @@ private:
   float time;
   uint8_t battery;
 
-  uint32_t lastHeartbeat = 0;
 
-  bool markedForReconnection = false;
 
   NimBLERemoteService* service;
   NimBLERemoteCharacteristic* weightCharacteristic;
@@ -44,6 +42,8 @@ private:
   void sendMessage(BookooMessageType msgType, const uint8_t* payload, size_t length, bool waitResponse = false);
   void sendEvent(const uint8_t* payload, size_t length);
   void sendHeartbeat();
+  void onTimer(ScaleTimer timer) override;
+  bool resubscribe() override;
   void sendNotificationRequest();
   void sendId();
   void notifyCallback(NimBLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
@@ -57,6 +57,7 @@ public:
       .id = "plugin-bookoo",
       .handles = [](const DiscoveredDevice& device) { return BookooScalesPlugin::handles(device); },
       .initialise = [](const DiscoveredDevice& device) -> std::unique_ptr<RemoteScales> { return std::make_unique<BookooScales>(device); },
+      .linkProfile = LOW_LATENCY_LINK_PROFILE,
     };
     RemoteScalesPluginRegistry::getInstance()->registerPlugin(plugin);
   }
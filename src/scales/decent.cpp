@@ -10,6 +10,7 @@ const NimBLEUUID writeCharacteristicUUID("36F5");
 
 DecentScales::DecentScales(const DiscoveredDevice& device)
   : RemoteScales(device) {
+  setTimerInterval(ScaleTimer::WATCHDOG, 1000);
 }
 
 DecentScales::~DecentScales() {}
@@ -37,8 +38,9 @@ bool DecentScales::connect() {
   if (!subscribeToNotifications()) {
     return false;
   }
+  RemoteScales::markConnectPhase(ConnectPhase::SUBSCRIBE);
 
-  RemoteScales::setWeight(0.f);
+  RemoteScales::resetWeight();
   return true;
 }
 
@@ -47,27 +49,14 @@ void DecentScales::disconnect() { RemoteScales::clientCleanup(); }
 bool DecentScales::isConnected() { return RemoteScales::clientIsConnected(); }
 
 void DecentScales::update() {
-  if (markedForReconnection) {
-    RemoteScales::log("Marked for disconnection. Will attempt to reconnect.\n");
-    RemoteScales::clientCleanup();
-    if (connect()) {
-      markedForReconnection = false;
-    }
-    else {
-      RemoteScales::log("Failed to reconnect\n");
-      return;
-    }
-  }
-  else {
-    verifyConnected();
-  }
+  runTimers();
 }
 
 bool DecentScales::tare() {
   if (!verifyConnected())
     return false;
   uint8_t payload[] = { 0x03, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x0C };
-  writeCharacteristic->writeValue(payload, sizeof(payload), false);
+  clientWrite(writeCharacteristic, payload, sizeof(payload), false);
   return true;
 };
 
@@ -82,6 +71,7 @@ bool DecentScales::performConnectionHandshake() {
     return false;
   }
   RemoteScales::log("Got Service\n");
+  RemoteScales::markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
 
   readCharacteristic = service->getCharacteristic(readCharacteristicUUID);
   writeCharacteristic = service->getCharacteristic(writeCharacteristicUUID);
@@ -90,6 +80,7 @@ bool DecentScales::performConnectionHandshake() {
     return false;
   }
   RemoteScales::log("Got readCharacteristic and writeCharacteristic\n");
+  RemoteScales::markConnectPhase(ConnectPhase::CHARACTERISTICS);
   return true;
 }
 
@@ -112,6 +103,18 @@ bool DecentScales::subscribeToNotifications() {
   return true;
 }
 
+// Unlike subscribeToNotifications() this leaves the connection up when it fails, the watchdog reconnects then.
+bool DecentScales::resubscribe() {
+  if (!isConnected()) {
+    return false;
+  }
+  auto callback = [this](NimBLERemoteCharacteristic* characteristic,
+    uint8_t* data, size_t length, bool isNotify) {
+      readCallback(characteristic, data, length, isNotify);
+    };
+  return readCharacteristic->subscribe(true, callback, false);
+}
+
 void DecentScales::readCallback(NimBLERemoteCharacteristic* pCharacteristic,
   uint8_t* pData, size_t length, bool isNotify) {
   if ((length == 7 || length == 10) && pData[0] == 0x03 && (pData[1] == 0xCA || pData[1] == 0xCE)) {
@@ -141,17 +144,11 @@ void DecentScales::handleWeightNotification(uint8_t* pData, size_t length) {
     }
   }
 
-  RemoteScales::setWeight(weight100 / 10.f);
+  RemoteScales::setWeightMilligrams(weight100 * 100); // Convert from 0.1g
   RemoteScales::log("Weight received\n");
 }
 
+// A lost link is retried by the reconnect policy, if enabled.
 bool DecentScales::verifyConnected() {
-  if (markedForReconnection) {
-    return false;
-  }
-  if (!isConnected()) {
-    markedForReconnection = true;
-    return false;
-  }
-  return true;
+  return isConnected();
 }
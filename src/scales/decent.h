@@ -20,13 +20,13 @@ private:
   NimBLERemoteCharacteristic* readCharacteristic;
   NimBLERemoteCharacteristic* writeCharacteristic;
 
-  bool markedForReconnection = false;
 
   void readCallback(NimBLERemoteCharacteristic* pCharacteristic, uint8_t* pData,
     size_t length, bool isNotify);
 
   bool performConnectionHandshake(void);
   bool subscribeToNotifications(void);
+  bool resubscribe(void) override;
   void handleWeightNotification(uint8_t* pData, size_t length);
   bool verifyConnected(void);
 };
@@ -44,6 +44,7 @@ public:
             -> std::unique_ptr<RemoteScales> {
           return std::make_unique<DecentScales>(device);
         },
+        .linkProfile = LOW_LATENCY_LINK_PROFILE,
     };
     RemoteScalesPluginRegistry::getInstance()->registerPlugin(plugin);
   }
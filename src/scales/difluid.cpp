@@ -13,7 +13,11 @@ const NimBLEUUID weightCharacteristicUUID("AA01");
 //-----------------------------------------------------------------------------------/
 //---------------------------        PUBLIC       -----------------------------------/
 //-----------------------------------------------------------------------------------/
-DifluidScales::DifluidScales(const DiscoveredDevice& device) : RemoteScales(device) {}
+DifluidScales::DifluidScales(const DiscoveredDevice& device) : RemoteScales(device) {
+    setTimerInterval(ScaleTimer::HEARTBEAT, 2000);
+    setKeepalivePolicy(KeepalivePolicy::ADAPTIVE);
+    setTimerInterval(ScaleTimer::WATCHDOG, 1000);
+}
 
 bool DifluidScales::connect() {
     if (isConnected()) {
@@ -30,7 +34,7 @@ bool DifluidScales::connect() {
         clientCleanup();
         return false;
     }
-    setWeight(0.f);
+    resetWeight();
     return true;
 }
 
@@ -43,14 +47,7 @@ bool DifluidScales::isConnected() {
 }
 
 void DifluidScales::update() {
-    if (markedForReconnection) {
-        log("Marked for reconnection. Attempting to reconnect.\n");
-        clientCleanup();
-        connect();
-        markedForReconnection = false;
-    } else {
-        sendHeartbeat();
-    }
+    runTimers();
 }
 
 // Tare function
@@ -59,7 +56,7 @@ bool DifluidScales::tare() {
     log("Tare command sent.\n");
     uint8_t tareCommand[] = {0xDF, 0xDF, 0x03, 0x02, 0x01, 0x01, 0x00};
     tareCommand[6] = calculateChecksum(tareCommand, sizeof(tareCommand));
-    weightCharacteristic->writeValue(tareCommand, sizeof(tareCommand), true);
+    clientWrite(weightCharacteristic, tareCommand, sizeof(tareCommand), true);
     return true;
 }
 
@@ -111,21 +108,21 @@ void DifluidScales::notifyCallback(
         if (dataLen >= 13 && length >= 6 + dataLen) {
             // Parse sensor data
             int32_t weightRaw = readInt32BE(&pData[5]);
-            float weight = weightRaw / 10.0f; // Assuming weight unit is grams x10
+            int32_t weightMg = weightRaw * 100; // Assuming weight unit is grams x10
 
             // Handle other data fields if necessary
             // ...
 
-            log("Weight: %.1f g\n", weight);
+            log("Weight: %.1f g\n", weightMg / 1000.f);
 
             // Call weight updated callback
-            setWeight(weight);
+            setWeightMilligrams(weightMg);
         } else {
             log("Invalid sensor data length.\n");
         }
     } else if (func == 0x03 && cmd == 0x05) { // Heartbeat Acknowledgment(Get Device Status)
         log("Heartbeat acknowledged.\n");
-        uint8_t battery_capacity = pData[6];  // Battery capacity percentage.
+        setBattery(pData[6]);  // Battery capacity percentage.
     } else {
         log("Unknown function (%02X) or command (%02X).\n", func, cmd);
     }
@@ -146,6 +143,7 @@ bool DifluidScales::performConnectionHandshake() {
         return false;
     }
     log("Service found.\n");
+    markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
 
     weightCharacteristic = service->getCharacteristic(weightCharacteristicUUID);
     if (weightCharacteristic == nullptr) {
@@ -153,6 +151,7 @@ bool DifluidScales::performConnectionHandshake() {
         return false;
     }
     log("Characteristic found.\n");
+    markConnectPhase(ConnectPhase::CHARACTERISTICS);
 
     // Subscribe to notifications
     if (weightCharacteristic->canNotify()) {
@@ -163,15 +162,18 @@ bool DifluidScales::performConnectionHandshake() {
         log("Cannot subscribe to notifications.\n");
         return false;
     }
+    markConnectPhase(ConnectPhase::SUBSCRIBE);
 
     // Set the scale unit to grams
     setUnitToGram();
+    setWeightUnit(WeightUnit::GRAMS);
 
     // Enable auto notifications
     enableAutoNotifications();
+    markConnectPhase(ConnectPhase::HANDSHAKE);
 
     // Initialize heartbeat timer
-    lastHeartbeat = millis();
+    startTimer(ScaleTimer::HEARTBEAT);
 
     return true;
 }
@@ -179,32 +181,41 @@ bool DifluidScales::performConnectionHandshake() {
 void DifluidScales::setUnitToGram() {
     uint8_t unitToGramCommand[] = {0xDF, 0xDF, 0x01, 0x04, 0x01, 0x00, 0x00}; // Last byte for checksum
     unitToGramCommand[6] = calculateChecksum(unitToGramCommand, sizeof(unitToGramCommand));
-    weightCharacteristic->writeValue(unitToGramCommand, sizeof(unitToGramCommand), true);
+    clientWrite(weightCharacteristic, unitToGramCommand, sizeof(unitToGramCommand), true);
     log("Set unit to grams.\n");
 }
 
+bool DifluidScales::resubscribe() {
+    if (!isConnected()) return false;
+    bool subscribed = weightCharacteristic->subscribe(true, [this](NimBLERemoteCharacteristic* characteristic, uint8_t* data, size_t length, bool isNotify) {
+        notifyCallback(characteristic, data, length, isNotify);
+    });
+    if (!subscribed) return false;
+    enableAutoNotifications();
+    return true;
+}
+
 void DifluidScales::enableAutoNotifications() {
     uint8_t enableNotificationsCommand[] = {0xDF, 0xDF, 0x01, 0x00, 0x01, 0x01, 0x00};
     enableNotificationsCommand[6] = calculateChecksum(enableNotificationsCommand, sizeof(enableNotificationsCommand));
-    weightCharacteristic->writeValue(enableNotificationsCommand, sizeof(enableNotificationsCommand), true);
+    clientWrite(weightCharacteristic, enableNotificationsCommand, sizeof(enableNotificationsCommand), true);
     log("Enabled auto notifications.\n");
 }
 
 void DifluidScales::sendHeartbeat() {
     if (!isConnected()) {
-        markedForReconnection=true;
-        return;
-    }
-
-    uint32_t now = millis();
-    if (now - lastHeartbeat < 2000) {
-        return;
+        return; // A lost link is retried by the reconnect policy
     }
 
     uint8_t heartbeatCommand[] = {0xDF, 0xDF, 0x03, 0x05, 0x00, 0xC6};  // Use Func 0x03 and Cmd 0x05(Get Device Status) as the heartbeat.
     heartbeatCommand[5] = calculateChecksum(heartbeatCommand, sizeof(heartbeatCommand));
-    weightCharacteristic->writeValue(heartbeatCommand, sizeof(heartbeatCommand), true);
-    lastHeartbeat = now;
+    clientWrite(weightCharacteristic, heartbeatCommand, sizeof(heartbeatCommand), true);
+}
+
+void DifluidScales::onTimer(ScaleTimer timer) {
+    if (timer == ScaleTimer::HEARTBEAT) {
+        sendHeartbeat();
+    }
 }
 
 // Calculate checksum according to the protocol
@@ -17,14 +17,14 @@ public:
 private:
     NimBLERemoteService *service = nullptr;
     NimBLERemoteCharacteristic *weightCharacteristic = nullptr;
-    uint32_t lastHeartbeat = 0;
-    bool markedForReconnection = false;
 
     void notifyCallback(NimBLERemoteCharacteristic *pBLERemoteCharacteristic, uint8_t *pData, size_t length, bool isNotify);
     bool performConnectionHandshake();
     void setUnitToGram();
     void enableAutoNotifications();
     void sendHeartbeat();
+    void onTimer(ScaleTimer timer) override;
+    bool resubscribe() override;
     uint8_t calculateChecksum(const uint8_t *data, size_t length);
     int32_t readInt32BE(const uint8_t *data);
 };
@@ -9,7 +9,9 @@ const NimBLEUUID ECLAIR_CONFIG_CHAR_UUID("4F9A45BA-8E1B-4E07-E157-0814D393B968")
 // ---------------------------------   PUBLIC   --------------------------------------
 // -----------------------------------------------------------------------------------
 
-EclairScales::EclairScales(const DiscoveredDevice& device) : RemoteScales(device) {}
+EclairScales::EclairScales(const DiscoveredDevice& device) : RemoteScales(device) {
+    setTimerInterval(ScaleTimer::HEARTBEAT, 2000);
+}
 
 bool EclairScales::connect() {
     if (RemoteScales::clientIsConnected()) {
@@ -31,8 +33,9 @@ bool EclairScales::connect() {
     }
 
     subscribeToNotifications();
-    RemoteScales::setWeight(0.f);
-    lastHeartbeat = millis();  // Initialize the heartbeat timestamp
+    RemoteScales::markConnectPhase(ConnectPhase::SUBSCRIBE);
+    RemoteScales::resetWeight();
+    startTimer(ScaleTimer::HEARTBEAT);
     return true;
 }
 
@@ -44,17 +47,9 @@ bool EclairScales::isConnected() {
     return RemoteScales::clientIsConnected();
 }
 
+// A lost link is retried by the reconnect policy, if enabled.
 void EclairScales::update() {
-    // Check if the device is connected; if not, attempt to reconnect
-    if (!isConnected()) {
-        RemoteScales::log("Device disconnected. Attempting to reconnect...\n");
-        if (connect()) {
-            lastHeartbeat = millis();  // Reset the heartbeat timer after reconnecting
-            RemoteScales::log("Reconnected to Eclair scale successfully.");
-        }
-    } else {
-        sendHeartbeat();  // Send the heartbeat signal if still connected
-    }
+    runTimers();  // Sends the heartbeat when it is due
 }
 
 bool EclairScales::tare() {
@@ -62,7 +57,7 @@ bool EclairScales::tare() {
     uint8_t tareCommand[2] = { static_cast<uint8_t>(EclairMessageType::TARE_COMMAND), 0x01 };
     uint8_t checksum = calculateXOR(&tareCommand[1], 1);  // Calculate checksum
     uint8_t message[3] = { tareCommand[0], tareCommand[1], checksum };
-    configCharacteristic->writeValue(message, sizeof(message), true);
+    clientWrite(configCharacteristic, message, sizeof(message), true);
     RemoteScales::log("Sent tare command\n");
     return true;
 }
@@ -80,6 +75,7 @@ bool EclairScales::performConnectionHandshake() {
         RemoteScales::clientCleanup();
         return false;
     }
+    RemoteScales::markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
 
     dataCharacteristic = service->getCharacteristic(ECLAIR_DATA_CHAR_UUID);
     configCharacteristic = service->getCharacteristic(ECLAIR_CONFIG_CHAR_UUID);
@@ -90,6 +86,7 @@ bool EclairScales::performConnectionHandshake() {
     }
 
     RemoteScales::log("Successfully obtained service and characteristics\n");
+    RemoteScales::markConnectPhase(ConnectPhase::CHARACTERISTICS);
     return true;
 }
 
@@ -103,7 +100,7 @@ void EclairScales::sendMessage(EclairMessageType msgType, const uint8_t* data, s
 
     RemoteScales::log("Sending message: %s\n", RemoteScales::byteArrayToHexString(bytes.get(), totalLength).c_str());
 
-    configCharacteristic->writeValue(bytes.get(), totalLength, waitResponse);
+    clientWrite(configCharacteristic, bytes.get(), totalLength, waitResponse);
 }
 
 void EclairScales::notifyCallback(NimBLERemoteCharacteristic* characteristic, uint8_t* data, size_t length, bool isNotify) {
@@ -136,8 +133,7 @@ void EclairScales::handleDataNotification(uint8_t* data, size_t length) {
     if (header == static_cast<uint8_t>(EclairMessageType::WEIGHT)) {
         int32_t rawWeight;
         memcpy(&rawWeight, &data[1], 4); // Assuming little-endian
-        float weight = rawWeight / 1000.0f; // Convert to grams
-        RemoteScales::setWeight(weight);
+        RemoteScales::setWeightMilligrams(rawWeight); // Already in milligrams
     } else if (header == static_cast<uint8_t>(EclairMessageType::FLOW_RATE)) {
         RemoteScales::log("Received flow rate data\n");
     } else {
@@ -162,8 +158,8 @@ void EclairScales::handleConfigNotification(uint8_t* data, size_t length) {
     }
 
     if (header == static_cast<uint8_t>(EclairMessageType::BATTERY_STATUS)) {
-        battery = value;
-        RemoteScales::log("Battery status updated: %d%%\n", battery);
+        RemoteScales::setBattery(value);
+        RemoteScales::log("Battery status updated: %d%%\n", value);
     } else if (header == static_cast<uint8_t>(EclairMessageType::TIMER_STATUS)) {
         RemoteScales::log("Timer status updated: %d\n", value);
     } else {
@@ -206,12 +202,12 @@ void EclairScales::sendHeartbeat() {
         return;
     }
 
-    uint32_t now = millis();
-    if (now - lastHeartbeat < 2000) {
-        return;
-    }
-
     uint8_t heartbeatCommand[] = { 0x00 };  // Example heartbeat command
     sendMessage(EclairMessageType::TIMER_STATUS, heartbeatCommand, sizeof(heartbeatCommand));
-    lastHeartbeat = now;
-}
\ No newline at end of file
+}
+
+void EclairScales::onTimer(ScaleTimer timer) {
+    if (timer == ScaleTimer::HEARTBEAT) {
+        sendHeartbeat();
+    }
+}
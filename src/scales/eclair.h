@@ -30,8 +30,6 @@ private:
     NimBLERemoteService* service = nullptr;
     NimBLERemoteCharacteristic* dataCharacteristic = nullptr;
     NimBLERemoteCharacteristic* configCharacteristic = nullptr;
-    uint8_t battery = 0;
-    uint32_t lastHeartbeat = 0;
 
     bool performConnectionHandshake();
     void sendMessage(EclairMessageType msgType, const uint8_t* data, size_t dataLength, bool waitResponse = false);
@@ -41,6 +39,7 @@ private:
     uint8_t calculateXOR(const uint8_t* data, size_t length);
     void subscribeToNotifications();
     void sendHeartbeat();
+    void onTimer(ScaleTimer timer) override;
 };
 
 class EclairScalesPlugin {
@@ -41,7 +41,8 @@ bool EurekaScales::connect() {
     return false;
   }
   subscribeToNotifications();
-  RemoteScales::setWeight(0.f);
+  RemoteScales::markConnectPhase(ConnectPhase::SUBSCRIBE);
+  RemoteScales::resetWeight();
   return true;
 }
 
@@ -54,16 +55,7 @@ bool EurekaScales::isConnected() {
 }
 
 void EurekaScales::update() {
-  if (markedForReconnection) {
-    RemoteScales::log("Marked for disconnection. Will attempt to reconnect.\n");
-    RemoteScales::clientCleanup();
-    connect();
-    markedForReconnection = false;
-  }
-  else {
-    sendHeartbeat();
-    RemoteScales::log("Heartbeat sent.\n");
-  }
+  runTimers();
 }
 
 bool EurekaScales::tare() {
@@ -103,13 +95,13 @@ bool EurekaScales::decodeAndHandleNotification() {
 
   size_t messageLength = dataBuffer.size();
 
-  float weight = (dataBuffer[8] << 8) + dataBuffer[7];
+  int32_t weight = (dataBuffer[8] << 8) + dataBuffer[7];
 
   if (dataBuffer[6]) { // Check if the value is negative
     weight = -weight;
   }
 
-  RemoteScales::setWeight(weight * 0.1f); // Convert to floating point
+  RemoteScales::setWeightMilligrams(weight * 100); // Convert from 0.1g
 
   // Remove processed message from the buffer
   dataBuffer.erase(dataBuffer.begin(), dataBuffer.end());
@@ -124,6 +116,7 @@ bool EurekaScales::performConnectionHandshake() {
   service = RemoteScales::clientGetService(serviceUUID);
   if (service != nullptr) {
     RemoteScales::log("Got Service\n");
+    RemoteScales::markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
   }
   else {
     clientCleanup();
@@ -137,6 +130,7 @@ bool EurekaScales::performConnectionHandshake() {
     return false;
   }
   RemoteScales::log("Got weightCharacteristic and commandCharacteristic\n");
+  RemoteScales::markConnectPhase(ConnectPhase::CHARACTERISTICS);
 
   return true;
 }
@@ -170,5 +164,5 @@ void EurekaScales::subscribeToNotifications() {
 void EurekaScales::sendMessage(const uint8_t* payload, size_t length, bool waitResponse) {
   auto bytes = std::make_unique<uint8_t[]>(length);
   memcpy(bytes.get(), payload, length);
-  commandCharacteristic->writeValue(bytes.get(), length, waitResponse);
+  clientWrite(commandCharacteristic, bytes.get(), length, waitResponse);
 }
@@ -19,7 +19,6 @@ public:
   bool tare() override;
 
 private:
-  bool markedForReconnection = false;
 
   NimBLERemoteService* service;
   NimBLERemoteCharacteristic* weightCharacteristic;
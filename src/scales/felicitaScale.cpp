@@ -22,7 +22,7 @@ bool FelicitaScale::connect() {
         clientCleanup();
         return false;
     }
-    setWeight(0.f);
+    resetWeight();
     return true;
 }
 
@@ -35,21 +35,14 @@ bool FelicitaScale::isConnected() {
 }
 
 void FelicitaScale::update() {
-    if (markedForReconnection) {
-        log("Reconnecting...\n");
-        clientCleanup();
-        connect();
-        markedForReconnection = false;
-    } else {
-      verifyConnected();
-    }
+    runTimers();
 }
 
 bool FelicitaScale::tare() {
     if (!verifyConnected()) return false;
     log("Tare command sent.\n");
     uint8_t tareCommand[] = {CMD_TARE};
-    dataCharacteristic->writeValue(tareCommand, sizeof(tareCommand), true);
+    clientWrite(dataCharacteristic, tareCommand, sizeof(tareCommand), true);
     return true;
 }
 
@@ -61,12 +54,14 @@ bool FelicitaScale::performConnectionHandshake() {
         log("Service not found.\n");
         return false;
     }
+    markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
 
     dataCharacteristic = service->getCharacteristic(DATA_CHARACTERISTIC_UUID);
     if (!dataCharacteristic) {
         log("Characteristic not found.\n");
         return false;
     }
+    markConnectPhase(ConnectPhase::CHARACTERISTICS);
 
     if (dataCharacteristic->canNotify()) {
         dataCharacteristic->subscribe(true, [this](NimBLERemoteCharacteristic* characteristic, uint8_t* data, size_t length, bool isNotify) {
@@ -76,18 +71,13 @@ bool FelicitaScale::performConnectionHandshake() {
         log("Notifications not supported.\n");
         return false;
     }
-    
+    markConnectPhase(ConnectPhase::SUBSCRIBE);
+
     return true;
 }
+// A lost link is retried by the reconnect policy, if enabled.
 bool FelicitaScale::verifyConnected() {
-  if (markedForReconnection) {
-    return false;
-  }
-  if (!isConnected()) {
-    markedForReconnection = true;
-    return false;
-  }
-  return true;
+    return isConnected();
 }
 
 void FelicitaScale::notifyCallback(NimBLERemoteCharacteristic* characteristic, uint8_t* data, size_t length, bool isNotify) {
@@ -100,9 +90,9 @@ void FelicitaScale::notifyCallback(NimBLERemoteCharacteristic* characteristic, u
 }
 
 void FelicitaScale::parseStatusUpdate(const uint8_t* data, size_t length) {
-    float weight = static_cast<float>(parseWeight(data)) / 100.0f;
-    setWeight(weight);
-    log("Weight updated: %.1f g\n", weight);
+    int32_t weightMg = parseWeight(data) * 10; // Convert from 0.01g
+    setWeightMilligrams(weightMg);
+    log("Weight updated: %.1f g\n", weightMg / 1000.f);
 }
 
 int32_t FelicitaScale::parseWeight(const uint8_t* data) {
@@ -17,7 +17,6 @@ private:
     NimBLERemoteService* service = nullptr;
     NimBLERemoteCharacteristic* dataCharacteristic = nullptr;
     uint32_t lastHeartbeat = 0;
-    bool markedForReconnection = false;
 
     void notifyCallback(NimBLERemoteCharacteristic* characteristic, uint8_t* data, size_t length, bool isNotify);
     bool performConnectionHandshake();
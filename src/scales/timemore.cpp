@@ -15,7 +15,9 @@ const NimBLEUUID commandCharacteristicUUID("553f4e49-bf21-4468-9c6c-0e4fb5b17697
 //-----------------------------------------------------------------------------------/
 //---------------------------        PUBLIC       -----------------------------------/
 //-----------------------------------------------------------------------------------/
-TimemoreScales::TimemoreScales(const DiscoveredDevice& device) : RemoteScales(device) {}
+TimemoreScales::TimemoreScales(const DiscoveredDevice& device) : RemoteScales(device) {
+  setTimerInterval(ScaleTimer::HEARTBEAT, 2000);
+}
 
 bool TimemoreScales::connect() {
   if (RemoteScales::clientIsConnected()) {
@@ -34,7 +36,8 @@ bool TimemoreScales::connect() {
     return false;
   }
   subscribeToNotifications();
-  RemoteScales::setWeight(0.f);
+  RemoteScales::markConnectPhase(ConnectPhase::SUBSCRIBE);
+  RemoteScales::resetWeight();
   return true;
 }
 
@@ -47,15 +50,7 @@ bool TimemoreScales::isConnected() {
 }
 
 void TimemoreScales::update() {
-  if (markedForReconnection) {
-    RemoteScales::log("Marked for disconnection. Will attempt to reconnect.\n");
-    RemoteScales::clientCleanup();
-    connect();
-    markedForReconnection = false;
-  }
-  else {
-    sendHeartbeat();
-  }
+  runTimers();
 }
 
 bool TimemoreScales::tare() {
@@ -97,9 +92,9 @@ bool TimemoreScales::decodeAndHandleNotification() {
     // E.g. 78 08 00 00 = 2168 / 10 = 216.8g
 
     //float_t dripperWeight = dataBuffer[1] | (dataBuffer[2] << 8) | (dataBuffer[3] << 16) | (dataBuffer[4] << 24);
-    float_t scaleWeight = dataBuffer[5] | (dataBuffer[6] << 8) | (dataBuffer[7] << 16) | (dataBuffer[8] << 24);
+    int32_t scaleWeight = dataBuffer[5] | (dataBuffer[6] << 8) | (dataBuffer[7] << 16) | (dataBuffer[8] << 24);
 
-    RemoteScales::setWeight(scaleWeight / 10.0f); // Convert to floating point
+    RemoteScales::setWeightMilligrams(scaleWeight * 100); // Convert from 0.1g
   }
   else {
     RemoteScales::log("Unknown message type %02X: %s\n", messageType, RemoteScales::byteArrayToHexString(dataBuffer.data(), dataBuffer.size()).c_str());
@@ -124,6 +119,7 @@ bool TimemoreScales::performConnectionHandshake() {
     return false;
   }
   RemoteScales::log("Got Service\n");
+  RemoteScales::markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
 
   weightCharacteristic = service->getCharacteristic(weightCharacteristicUUID);
   commandCharacteristic = service->getCharacteristic(commandCharacteristicUUID);
@@ -133,6 +129,7 @@ bool TimemoreScales::performConnectionHandshake() {
     return false;
   }
   RemoteScales::log("Got weightCharacteristic and commandCharacteristic\n");
+  RemoteScales::markConnectPhase(ConnectPhase::CHARACTERISTICS);
 
   // Subscribe
   NimBLERemoteDescriptor* notifyDescriptor = weightCharacteristic->getDescriptor(NimBLEUUID((uint16_t)0x2902));
@@ -140,6 +137,7 @@ bool TimemoreScales::performConnectionHandshake() {
   if (notifyDescriptor != nullptr) {
     uint8_t value[2] = { 0x01, 0x00 };
     notifyDescriptor->writeValue(value, 2, true);
+    RemoteScales::markConnectPhase(ConnectPhase::SUBSCRIBE);
   }
   else {
     clientCleanup();
@@ -148,7 +146,8 @@ bool TimemoreScales::performConnectionHandshake() {
 
   sendNotificationRequest();
   RemoteScales::log("Sent notification request\n");
-  lastHeartbeat = millis();
+  RemoteScales::markConnectPhase(ConnectPhase::HANDSHAKE);
+  startTimer(ScaleTimer::HEARTBEAT);
   return true;
 }
 
@@ -162,14 +161,14 @@ void TimemoreScales::sendHeartbeat() {
     return;
   }
 
-  uint32_t now = millis();
-  if (now - lastHeartbeat < 2000) {
-    return;
-  }
-
   uint8_t payload[] = { 0x00 };
   sendMessage(TimemoreMessageType::WEIGHT, payload, 1);
-  lastHeartbeat = now;
+}
+
+void TimemoreScales::onTimer(ScaleTimer timer) {
+  if (timer == ScaleTimer::HEARTBEAT) {
+    sendHeartbeat();
+  }
 }
 
 void TimemoreScales::subscribeToNotifications() {
@@ -179,15 +178,24 @@ void TimemoreScales::subscribeToNotifications() {
     notifyCallback(characteristic, data, length, isNotify);
   };
 
-  if (weightCharacteristic->canIndicate()) {
+  // Indications need an acknowledgement per packet, which limits how often the scale can send.
+  bool useNotifications = RemoteScales::getStreamingProfile() == StreamingProfile::MAX_RATE && weightCharacteristic->canNotify();
+  if (useNotifications) {
+    weightCharacteristic->subscribe(true, callback, true);
+  }
+  else if (weightCharacteristic->canIndicate()) {
     weightCharacteristic->subscribe(false, callback, true);
   }
 }
 
+void TimemoreScales::applyStreamingProfile(StreamingProfile profile) {
+  subscribeToNotifications();
+}
+
 void TimemoreScales::sendMessage(TimemoreMessageType msgType, const uint8_t* payload, size_t length, bool waitResponse) {
   if (msgType == TimemoreMessageType::TARE) {
-    commandCharacteristic->writeValue(payload, length, true);
+    clientWrite(commandCharacteristic, payload, length, true);
   } else if (msgType == TimemoreMessageType::WEIGHT) {
-    weightCharacteristic->writeValue(payload, length, true);
+    clientWrite(weightCharacteristic, payload, length, true);
   }
 }
\ No newline at end of file
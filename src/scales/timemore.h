@@ -24,9 +24,7 @@ public:
   bool tare() override;
 
 private:
-  uint32_t lastHeartbeat = 0;
 
-  bool markedForReconnection = false;
 
   NimBLERemoteService* service;
   NimBLERemoteCharacteristic* weightCharacteristic;
@@ -39,6 +37,8 @@ private:
 
   void sendMessage(TimemoreMessageType msgType, const uint8_t* payload, size_t length, bool waitResponse = false);
   void sendHeartbeat();
+  void onTimer(ScaleTimer timer) override;
+  void applyStreamingProfile(StreamingProfile profile) override;
   void sendNotificationRequest();
   void notifyCallback(NimBLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
   bool decodeAndHandleNotification();
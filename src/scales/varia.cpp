@@ -26,9 +26,10 @@ bool VariaScales::connect() {
     return false;
   }
 
-  setWeight(0.f);
+  resetWeight();
 
   subscribeToNotifications();
+  markConnectPhase(ConnectPhase::SUBSCRIBE);
 
   return true;
 }
@@ -58,6 +59,7 @@ bool VariaScales::fetchServices() {
   service = clientGetService(serviceUUID);
   if (service != nullptr) {
     log("Got Service\n");
+    markConnectPhase(ConnectPhase::SERVICE_DISCOVERY);
   }
   else {
     clientCleanup();
@@ -68,6 +70,7 @@ bool VariaScales::fetchServices() {
   commandCharacteristic = service->getCharacteristic(commandCharacteristicUUID);
   if (weightCharacteristic != nullptr && commandCharacteristic != nullptr) {
     log("Got Weight and Command Characteristics\n");
+    markConnectPhase(ConnectPhase::CHARACTERISTICS);
   }
   else {
     clientCleanup();
@@ -102,7 +105,7 @@ void VariaScales::sendMessage(VariaMessageType msgType, const uint8_t* payload,
   memcpy(bytes.get()+1, payload, payloadLen);
   bytes[msgLen - 1] = checksum;
 
-  commandCharacteristic->writeValue(bytes.get(), msgLen, waitResponse);
+  clientWrite(commandCharacteristic, bytes.get(), msgLen, waitResponse);
 }
 
 void VariaScales::notifyCallback(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* data, size_t length, bool isNotify) {
@@ -129,7 +132,7 @@ void VariaScales::notifyCallback(NimBLERemoteCharacteristic* pRemoteCharacterist
       }
       int sign = (data[3] & 0x10) == 0 ? 1 : -1;
       int value = ((data[3] & 0x0f) << 16) + (data[4] << 8) + data[5];
-      setWeight(sign * value * 0.01f);
+      setWeightMilligrams(sign * value * 10); // Convert from 0.01g
       data += msgLen;
       length -= msgLen;
       break;
@@ -142,7 +145,8 @@ void VariaScales::notifyCallback(NimBLERemoteCharacteristic* pRemoteCharacterist
         log("Invalid message of type %02x: %s\n", messageType, byteArrayToHexString(data, length).c_str());
         return;
       }
-      timerSeconds = (data[3] << 8) + data[4];
+      int timerSeconds = (data[3] << 8) + data[4];
+      setTimer(getStatus().timerState, timerSeconds * 1000);
       data += msgLen;
       length -= msgLen;
       break;
@@ -160,6 +164,15 @@ void VariaScales::notifyCallback(NimBLERemoteCharacteristic* pRemoteCharacterist
         return;
       }
       log("Timer event: %02x\n", data[1]);
+      if (messageType == VariaMessageType::TIMER_START) {
+        setTimer(TimerState::RUNNING, getStatus().timerMs);
+      }
+      else if (messageType == VariaMessageType::TIMER_STOP) {
+        setTimer(TimerState::STOPPED, getStatus().timerMs);
+      }
+      else {
+        setTimer(TimerState::STOPPED, 0);
+      }
       data += msgLen;
       length -= msgLen;
       break;
@@ -172,7 +185,7 @@ void VariaScales::notifyCallback(NimBLERemoteCharacteristic* pRemoteCharacterist
         log("Invalid message of type %02x: %s\n", messageType, byteArrayToHexString(data, length).c_str());
         return;
       }
-      batteryPercent = data[3];
+      setBattery(data[3]);
       data += msgLen;
       length -= msgLen;
       break;
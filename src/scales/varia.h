@@ -17,7 +17,7 @@ class VariaScales : public RemoteScales {
 
 public:
   VariaScales(const DiscoveredDevice& device);
-  void update() override {};
+  void update() override { runTimers(); };
   bool connect() override;
   void disconnect() override;
   bool isConnected() override;
@@ -28,9 +28,6 @@ private:
   NimBLERemoteCharacteristic* weightCharacteristic = nullptr;
   NimBLERemoteCharacteristic* commandCharacteristic = nullptr;
 
-  int batteryPercent = 0;
-  int timerSeconds = 0;
-
   bool fetchServices();
   void subscribeToNotifications();
 
@@ -0,0 +1,80 @@
+#include "scan_scheduler.h"
+#include <algorithm>
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   ScanScheduler methods    --------------------------------
+// ---------------------------------------------------------------------------------------
+
+ScanScheduler::ScanScheduler() {
+  // NimBLE takes interval and window in milliseconds. Duty-cycle = window / interval.
+  setParameters(ScanMode::BURST, ScanParameters{ .intervalMs = 100, .windowMs = 80 });       // 80%
+  setParameters(ScanMode::HIGH_DUTY, ScanParameters{ .intervalMs = 200, .windowMs = 60 });   // 30%
+  setParameters(ScanMode::LOW_DUTY, ScanParameters{ .intervalMs = 1280, .windowMs = 48 });   // ~4%
+}
+
+void ScanScheduler::begin(uint32_t now) {
+  lastActivityAt = now;
+  lastMatchAt = 0;
+  averageMatchIntervalMs = 0;
+  pendingWakeUp = false;
+  enterMode(ScanMode::BURST, now);
+}
+
+void ScanScheduler::onUserAction(uint32_t now) {
+  lastActivityAt = now;
+  pendingWakeUp = true;
+}
+
+void ScanScheduler::onMatchingAdvert(uint32_t now, bool newDevice) {
+  uint32_t previousMatchAt = lastMatchAt.exchange(now);
+  if (previousMatchAt != 0) {
+    uint32_t interval = now - previousMatchAt;
+    uint32_t average = averageMatchIntervalMs;
+    averageMatchIntervalMs = (average == 0) ? interval : (average * 3 + interval) / 4;
+  }
+
+  if (newDevice) {
+    lastActivityAt = now;
+    pendingWakeUp = true;
+  }
+}
+
+bool ScanScheduler::update(uint32_t now) {
+  switch (mode) {
+  case ScanMode::BURST:
+    if (now - modeStartedAt < burstDurationMs) {
+      return false;
+    }
+    // Stay attentive if something showed up during the burst, otherwise back off straight away.
+    enterMode(pendingWakeUp.exchange(false) ? ScanMode::HIGH_DUTY : ScanMode::LOW_DUTY, now);
+    return true;
+  case ScanMode::HIGH_DUTY:
+    pendingWakeUp = false;
+    if (now - lastActivityAt < highDutyHold()) {
+      return false;
+    }
+    enterMode(ScanMode::LOW_DUTY, now);
+    return true;
+  case ScanMode::LOW_DUTY:
+    if (!pendingWakeUp.exchange(false)) {
+      return false;
+    }
+    enterMode(ScanMode::HIGH_DUTY, now);
+    return true;
+  }
+  return false;
+}
+
+// Scales that advertise sparsely need a longer high duty period before we give up on them.
+uint32_t ScanScheduler::highDutyHold() const {
+  uint32_t average = averageMatchIntervalMs;
+  if (average == 0) {
+    return minHoldMs;
+  }
+  return std::clamp(std::min(average, maxHoldMs) * 4, minHoldMs, maxHoldMs);
+}
+
+void ScanScheduler::enterMode(ScanMode newMode, uint32_t now) {
+  mode = newMode;
+  modeStartedAt = now;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+enum class ScanMode : uint8_t {
+  BURST,      // Right after the scan is started; catch scales that are already advertising.
+  HIGH_DUTY,  // After a user action or a newly seen scale; keep discovery latency low.
+  LOW_DUTY,   // Nothing interesting around; leave the shared radio to Wi-Fi.
+};
+
+struct ScanParameters {
+  uint16_t intervalMs;
+  uint16_t windowMs;
+};
+
+// Decides which scan duty-cycle the scanner should be running with.
+// Matching adverts are reported from the BLE host task while update() runs on the app task,
+// so everything written from onMatchingAdvert() is atomic.
+class ScanScheduler {
+public:
+  ScanScheduler();
+
+  void begin(uint32_t now);
+  void onUserAction(uint32_t now);
+  void onMatchingAdvert(uint32_t now, bool newDevice);
+
+  // Returns true when the mode changed and the scan has to be restarted with the new parameters.
+  bool update(uint32_t now);
+
+  ScanMode getMode() const { return mode; }
+  ScanParameters getParameters() const { return getParameters(mode); }
+  ScanParameters getParameters(ScanMode scanMode) const { return parameters[static_cast<uint8_t>(scanMode)]; }
+  void setParameters(ScanMode scanMode, ScanParameters scanParameters) { parameters[static_cast<uint8_t>(scanMode)] = scanParameters; }
+
+  void setBurstDuration(uint32_t durationMs) { burstDurationMs = durationMs; }
+  void setHighDutyHold(uint32_t minHoldMs, uint32_t maxHoldMs) { this->minHoldMs = minHoldMs; this->maxHoldMs = maxHoldMs; }
+
+private:
+  ScanMode mode = ScanMode::LOW_DUTY;
+  ScanParameters parameters[3];
+
+  uint32_t modeStartedAt = 0;
+  uint32_t burstDurationMs = 5000;
+  uint32_t minHoldMs = 5000;
+  uint32_t maxHoldMs = 30000;
+
+  std::atomic<uint32_t> lastActivityAt{ 0 };
+  std::atomic<uint32_t> lastMatchAt{ 0 };
+  std::atomic<uint32_t> averageMatchIntervalMs{ 0 };
+  std::atomic<bool> pendingWakeUp{ false };
+
+  uint32_t highDutyHold() const;
+  void enterMode(ScanMode newMode, uint32_t now);
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Snapshot of the scanner counters since the scan was started or the stats were reset.
+struct ScannerStats {
+  uint32_t elapsedMs;
+  uint32_t advertsReceived;
+  uint32_t tableLookups;         // One per advert, against the device table.
+  uint32_t tableHits;            // Adverts from an address that was already known.
+  uint32_t registryMatches;      // Times the plugin registry had to run.
+  uint32_t scalesFound;
+  uint32_t timeToFirstScaleMs;   // From the start of the scan. 0 if no scale was found yet.
+  float advertsPerSecond;
+  float matchesPerSecond;
+
+  float tableHitRatio() const { return tableLookups == 0 ? 0.f : static_cast<float>(tableHits) / tableLookups; }
+};
+
+// Counters written from the BLE host task. Relaxed atomics are enough as they're independent
+// and only ever read as a whole for reporting.
+class ScannerCounters {
+public:
+  void reset(uint32_t now) {
+    startedAt.store(now, std::memory_order_relaxed);
+    firstScaleAt.store(0, std::memory_order_relaxed);
+    adverts.store(0, std::memory_order_relaxed);
+    lookups.store(0, std::memory_order_relaxed);
+    hits.store(0, std::memory_order_relaxed);
+    registryMatches.store(0, std::memory_order_relaxed);
+    scales.store(0, std::memory_order_relaxed);
+  }
+
+  void onAdvert() { adverts.fetch_add(1, std::memory_order_relaxed); }
+  void onTableLookup(bool hit) {
+    lookups.fetch_add(1, std::memory_order_relaxed);
+    if (hit) hits.fetch_add(1, std::memory_order_relaxed);
+  }
+  void onRegistryMatch() { registryMatches.fetch_add(1, std::memory_order_relaxed); }
+  void onScaleFound(uint32_t now) {
+    scales.fetch_add(1, std::memory_order_relaxed);
+    uint32_t expected = 0;
+    // 0 marks "not found yet", nudge a scale found at the very first millisecond.
+    firstScaleAt.compare_exchange_strong(expected, now == 0 ? 1 : now, std::memory_order_relaxed);
+  }
+
+  ScannerStats snapshot(uint32_t now) const {
+    ScannerStats stats;
+    uint32_t start = startedAt.load(std::memory_order_relaxed);
+    uint32_t firstScale = firstScaleAt.load(std::memory_order_relaxed);
+    stats.elapsedMs = now - start;
+    stats.advertsReceived = adverts.load(std::memory_order_relaxed);
+    stats.tableLookups = lookups.load(std::memory_order_relaxed);
+    stats.tableHits = hits.load(std::memory_order_relaxed);
+    stats.registryMatches = registryMatches.load(std::memory_order_relaxed);
+    stats.scalesFound = scales.load(std::memory_order_relaxed);
+    stats.timeToFirstScaleMs = firstScale == 0 ? 0 : firstScale - start;
+    float elapsedSeconds = stats.elapsedMs / 1000.f;
+    stats.advertsPerSecond = elapsedSeconds > 0.f ? stats.advertsReceived / elapsedSeconds : 0.f;
+    stats.matchesPerSecond = elapsedSeconds > 0.f ? stats.registryMatches / elapsedSeconds : 0.f;
+    return stats;
+  }
+
+private:
+  std::atomic<uint32_t> startedAt{ 0 };
+  std::atomic<uint32_t> firstScaleAt{ 0 };
+  std::atomic<uint32_t> adverts{ 0 };
+  std::atomic<uint32_t> lookups{ 0 };
+  std::atomic<uint32_t> hits{ 0 };
+  std::atomic<uint32_t> registryMatches{ 0 };
+  std::atomic<uint32_t> scales{ 0 };
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Publishes a small value from one writer to any number of readers on other tasks or cores without locks.
+// Readers retry while a write is in progress, so they always get a consistent copy. Writers must not
+// overlap, guard store() with a mutex if more than one task writes.
+template<typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock values are copied word by word");
+
+public:
+  Seqlock() { store(T()); }
+
+  void store(const T& value) {
+    uint32_t buffer[WORDS] = {};
+    memcpy(buffer, &value, sizeof(T));
+
+    uint32_t currentSequence = sequence.load(std::memory_order_relaxed);
+    sequence.store(currentSequence + 1, std::memory_order_relaxed); // Odd while writing
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) {
+      words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+    sequence.store(currentSequence + 2, std::memory_order_release);
+  }
+
+  T load() const {
+    uint32_t buffer[WORDS];
+    uint32_t before;
+    uint32_t after;
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WORDS; i++) {
+        buffer[i] = words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    T value;
+    memcpy(&value, buffer, sizeof(T));
+    return value;
+  }
+
+private:
+  static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  std::atomic<uint32_t> sequence{ 0 };
+  std::array<std::atomic<uint32_t>, WORDS> words = {};
+};
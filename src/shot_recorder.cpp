@@ -0,0 +1,288 @@
+#include "shot_recorder.h"
+#include <cstdlib>
+#include <algorithm>
+#ifdef ESP_PLATFORM
+#include <esp_heap_caps.h>
+#endif
+
+static uint8_t* allocateArena(size_t size);
+static void writeUint32(uint8_t* data, uint32_t value);
+static uint32_t readUint32(const uint8_t* data);
+static uint8_t* writeVarint(uint8_t* data, uint32_t value);
+static const uint8_t* readVarint(const uint8_t* data, const uint8_t* end, uint32_t& value);
+static uint32_t zigzagEncode(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+static int32_t zigzagDecode(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1); }
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   ShotRecorder methods    ---------------------------------
+// ---------------------------------------------------------------------------------------
+
+ShotRecorder::ShotRecorder(size_t arenaSize, uint8_t weightResolutionMg) : weightResolutionMg(weightResolutionMg == 0 ? 1 : weightResolutionMg) {
+  arena = allocateArena(arenaSize);
+  capacity = arena != nullptr ? arenaSize : 0;
+}
+
+ShotRecorder::~ShotRecorder() {
+  detach();
+  free(arena);
+}
+
+void ShotRecorder::attach(RemoteScales& scales) {
+  detach();
+  attachedScales = &scales;
+  sampleListenerId = scales.addSampleListener([this](const WeightSample& sample) { addSample(sample); });
+}
+
+void ShotRecorder::detach() {
+  if (attachedScales == nullptr) {
+    return;
+  }
+  attachedScales->removeSampleListener(sampleListenerId);
+  attachedScales = nullptr;
+}
+
+bool ShotRecorder::start() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (recording) {
+    return false;
+  }
+  while (used > 0 && getFree() < MIN_FREE_ON_START) {
+    dropOldestShot();
+  }
+  if (getFree() < MIN_FREE_ON_START) {
+    return false; // Arena is too small to be useful
+  }
+
+  shotLength = HEADER_LENGTH;
+  shotSampleCount = 0;
+  recording = true;
+  return true;
+}
+
+void ShotRecorder::stop() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (recording) {
+    finishShot(false);
+  }
+}
+
+void ShotRecorder::addSample(const WeightSample& sample) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!recording) {
+    return;
+  }
+
+  // Round to the nearest unit, away from zero on ties.
+  int32_t halfUnit = sample.weightMg < 0 ? -(weightResolutionMg / 2) : weightResolutionMg / 2;
+  int32_t weightUnits = (sample.weightMg + halfUnit) / weightResolutionMg;
+  if (shotSampleCount == 0) {
+    // The first sample is stored relative to the start of the shot and zero weight.
+    lastTimestamp = sample.timestamp;
+    lastWeightUnits = 0;
+  }
+
+  uint8_t encoded[MAX_SAMPLE_LENGTH];
+  uint8_t* position = writeVarint(encoded, sample.timestamp - lastTimestamp);
+  position = writeVarint(position, zigzagEncode(weightUnits - lastWeightUnits));
+  size_t length = position - encoded;
+
+  while (used > 0 && getFree() < length) {
+    dropOldestShot();
+  }
+  if (getFree() < length || shotSampleCount == UINT16_MAX) {
+    finishShot(true);
+    return;
+  }
+
+  if (shotSampleCount == 0) {
+    uint8_t timestamp[4];
+    writeUint32(timestamp, sample.timestamp);
+    writeBytes(used, timestamp, sizeof(timestamp));
+  }
+  writeBytes(used + shotLength, encoded, length);
+  shotLength += length;
+  lastTimestamp = sample.timestamp;
+  lastWeightUnits = weightUnits;
+  shotSampleCount++;
+}
+
+size_t ShotRecorder::getShotCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t count = 0;
+  size_t offset = 0;
+  while (offset < used) {
+    offset += HEADER_LENGTH + readShotLength(offset);
+    count++;
+  }
+  return count;
+}
+
+bool ShotRecorder::exportShot(size_t index, std::vector<uint8_t>& shot) {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t offset;
+  size_t length;
+  if (!findShot(index, offset, length)) {
+    return false;
+  }
+  shot.resize(length);
+  readBytes(offset, shot.data(), length);
+  return true;
+}
+
+void ShotRecorder::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  head = 0;
+  used = 0;
+  recording = false;
+}
+
+void ShotRecorder::writeBytes(size_t offset, const uint8_t* data, size_t length) {
+  size_t position = (head + offset) % capacity;
+  size_t first = std::min(length, capacity - position);
+  memcpy(arena + position, data, first);
+  memcpy(arena, data + first, length - first);
+}
+
+void ShotRecorder::readBytes(size_t offset, uint8_t* data, size_t length) const {
+  size_t position = (head + offset) % capacity;
+  size_t first = std::min(length, capacity - position);
+  memcpy(data, arena + position, first);
+  memcpy(data + first, arena, length - first);
+}
+
+uint32_t ShotRecorder::readShotLength(size_t offset) const {
+  uint8_t length[4];
+  readBytes(offset + 4, length, sizeof(length));
+  return readUint32(length);
+}
+
+bool ShotRecorder::findShot(size_t index, size_t& offset, size_t& length) {
+  offset = 0;
+  while (offset < used) {
+    length = HEADER_LENGTH + readShotLength(offset);
+    if (index == 0) {
+      return true;
+    }
+    offset += length;
+    index--;
+  }
+  return false;
+}
+
+void ShotRecorder::dropOldestShot() {
+  size_t length = HEADER_LENGTH + readShotLength(0);
+  head = (head + length) % capacity;
+  used -= length;
+}
+
+void ShotRecorder::finishShot(bool truncated) {
+  recording = false;
+  if (shotSampleCount == 0) {
+    return; // Nothing worth keeping
+  }
+
+  uint8_t header[HEADER_LENGTH - 4];
+  writeUint32(header, shotLength - HEADER_LENGTH);
+  header[4] = shotSampleCount & 0xFF;
+  header[5] = shotSampleCount >> 8;
+  header[6] = truncated ? FLAG_TRUNCATED : 0;
+  header[7] = weightResolutionMg;
+  writeBytes(used + 4, header, sizeof(header));
+  used += shotLength;
+}
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   ShotDecoder methods    ----------------------------------
+// ---------------------------------------------------------------------------------------
+
+ShotDecoder::ShotDecoder(const uint8_t* data, size_t length) {
+  if (data == nullptr || length < 12) {
+    return;
+  }
+  uint32_t payloadLength = readUint32(data + 4);
+  if (payloadLength > length - 12 || data[11] == 0) {
+    return;
+  }
+
+  startTimestamp = readUint32(data);
+  sampleCount = data[8] | (data[9] << 8);
+  truncated = (data[10] & 0x01) != 0;
+  weightResolutionMg = data[11];
+  position = data + 12;
+  end = position + payloadLength;
+  timestamp = startTimestamp;
+  valid = true;
+}
+
+bool ShotDecoder::next(WeightSample& sample) {
+  if (!valid || samplesRead >= sampleCount) {
+    return false;
+  }
+
+  uint32_t timeDelta;
+  uint32_t weightDelta;
+  position = readVarint(position, end, timeDelta);
+  position = position != nullptr ? readVarint(position, end, weightDelta) : nullptr;
+  if (position == nullptr) {
+    valid = false;
+    return false;
+  }
+
+  timestamp += timeDelta;
+  weightUnits += zigzagDecode(weightDelta);
+  samplesRead++;
+
+  sample.timestamp = timestamp;
+  sample.weightMg = weightUnits * weightResolutionMg;
+  return true;
+}
+
+// ---------------------------------------------------------------------------------------
+// ------------------------------   Helpers    -------------------------------------------
+// ---------------------------------------------------------------------------------------
+
+static uint8_t* allocateArena(size_t size) {
+#ifdef ESP_PLATFORM
+  // Prefer PSRAM, it's plentiful and the arena isn't accessed often enough for its speed to matter.
+  void* memory = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (memory == nullptr) {
+    memory = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+  }
+  return static_cast<uint8_t*>(memory);
+#else
+  return static_cast<uint8_t*>(malloc(size));
+#endif
+}
+
+static void writeUint32(uint8_t* data, uint32_t value) {
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+  data[2] = (value >> 16) & 0xFF;
+  data[3] = (value >> 24) & 0xFF;
+}
+
+static uint32_t readUint32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// LEB128: 7 bits per byte, least significant group first, high bit set on all but the last byte.
+static uint8_t* writeVarint(uint8_t* data, uint32_t value) {
+  while (value >= 0x80) {
+    *data++ = static_cast<uint8_t>(value) | 0x80;
+    value >>= 7;
+  }
+  *data++ = static_cast<uint8_t>(value);
+  return data;
+}
+
+static const uint8_t* readVarint(const uint8_t* data, const uint8_t* end, uint32_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35 && data < end; shift += 7) {
+    uint8_t byte = *data++;
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return data;
+    }
+  }
+  return nullptr;
+}
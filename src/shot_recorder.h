@@ -0,0 +1,102 @@
+#pragma once
+#include "remote_scales.h"
+#include <mutex>
+
+// Decodes one exported shot, sample by sample.
+class ShotDecoder {
+public:
+  ShotDecoder(const uint8_t* data, size_t length);
+  ShotDecoder(const std::vector<uint8_t>& shot) : ShotDecoder(shot.data(), shot.size()) {}
+
+  bool isValid() const { return valid; }
+  uint32_t getStartTimestamp() const { return startTimestamp; }
+  uint16_t getSampleCount() const { return sampleCount; }
+  bool isTruncated() const { return truncated; }
+
+  // Returns false once all samples were read, or if the data is corrupt.
+  bool next(WeightSample& sample);
+
+private:
+  const uint8_t* position = nullptr;
+  const uint8_t* end = nullptr;
+  bool valid = false;
+  bool truncated = false;
+  uint32_t startTimestamp = 0;
+  uint16_t sampleCount = 0;
+  uint16_t samplesRead = 0;
+  uint8_t weightResolutionMg = 0;
+  uint32_t timestamp = 0;
+  int32_t weightUnits = 0;
+};
+
+// Records the weight curve of shots in a preallocated arena (in PSRAM when the board has it).
+// Each sample is stored as a time delta in ms and a zigzag encoded weight delta in fixed-point
+// units of weightResolutionMg, both as varints. At 10-20Hz that is about 2 bytes per sample.
+// The arena is a ring: when it fills up the oldest shot is dropped by moving past it, without
+// copying anything, so the host task adding samples is never held up. Only a shot that fills the
+// whole arena on its own is truncated.
+//
+// Shot layout in the arena:
+// ---------------------------------------------------------------------------------------
+// | start timestamp | payload length | sample count | flags | resolution |   samples   |
+// |     4 bytes     |    4 bytes     |   2 bytes    | 1 byte|   1 byte   | varints ... |
+// ---------------------------------------------------------------------------------------
+class ShotRecorder {
+public:
+  // A resolution of 0 is taken as 1mg.
+  ShotRecorder(size_t arenaSize, uint8_t weightResolutionMg = 10);
+  ~ShotRecorder();
+
+  ShotRecorder(const ShotRecorder&) = delete;
+  void operator=(const ShotRecorder&) = delete;
+
+  // Records samples of these scales from now on. Attach while the scales are disconnected.
+  void attach(RemoteScales& scales);
+  void detach();
+
+  // Starts a new shot, dropping the oldest shots while the arena is running out of space.
+  bool start();
+  void stop();
+  bool isRecording() const { return recording; }
+  void addSample(const WeightSample& sample);
+
+  size_t getShotCount();
+  // By the finished shots.
+  size_t getBytesUsed() const { return used; }
+  size_t getCapacity() const { return capacity; }
+
+  // Copies a finished shot (header included) so it can be stored, sent or fed to a ShotDecoder.
+  bool exportShot(size_t index, std::vector<uint8_t>& shot);
+  void clear();
+
+private:
+  static constexpr size_t HEADER_LENGTH = 12;
+  static constexpr size_t MAX_SAMPLE_LENGTH = 10; // Two 5 byte varints
+  static constexpr size_t MIN_FREE_ON_START = HEADER_LENGTH + 64 * MAX_SAMPLE_LENGTH;
+  static constexpr uint8_t FLAG_TRUNCATED = 0x01;
+
+  std::mutex mutex;
+  uint8_t* arena = nullptr;
+  size_t capacity = 0;
+  size_t head = 0;  // Where the oldest shot starts
+  size_t used = 0;  // Bytes of the finished shots from head on, the shot being recorded follows them
+  uint8_t weightResolutionMg;
+
+  bool recording = false;
+  size_t shotLength = 0;  // Bytes of the shot being recorded, header included
+  uint16_t shotSampleCount = 0;
+  uint32_t lastTimestamp = 0;
+  int32_t lastWeightUnits = 0;
+
+  RemoteScales* attachedScales = nullptr;
+  size_t sampleListenerId = 0;
+
+  // Offsets are relative to head and wrap around the end of the arena.
+  void writeBytes(size_t offset, const uint8_t* data, size_t length);
+  void readBytes(size_t offset, uint8_t* data, size_t length) const;
+  uint32_t readShotLength(size_t offset) const;
+  size_t getFree() const { return capacity - used - (recording ? shotLength : 0); }
+  bool findShot(size_t index, size_t& offset, size_t& length);
+  void dropOldestShot();
+  void finishShot(bool truncated);
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <cstddef>
+
+// Lock-free queue for exactly one producer task and one consumer task.
+// Capacity must be a power of two. When full, push() fails and the item is dropped.
+template<typename T, size_t Capacity>
+class SpscRingBuffer {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  bool push(const T& item) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead - tail.load(std::memory_order_acquire) == Capacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    items[currentHead & (Capacity - 1)] = item;
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[currentTail & (Capacity - 1)];
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+  size_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  std::array<T, Capacity> items;
+  std::atomic<size_t> head{ 0 };
+  std::atomic<size_t> tail{ 0 };
+  std::atomic<size_t> dropped{ 0 };
+};
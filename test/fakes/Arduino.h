@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cstdarg>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+// Host build only: time is simulated, so a benchmark run doesn't depend on how fast the host is.
+namespace sim {
+inline uint32_t clockMs = 0;
+}
+
+inline uint32_t millis() { return sim::clockMs; }
+inline void delay(uint32_t ms) { sim::clockMs += ms; }
@@ -0,0 +1,604 @@
+#pragma once
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+
+// Host build only: a functional stand-in for the parts of NimBLE-Arduino 1.4 the drivers use. Clients
+// connect to simulated peers (sim::Peer) instead of a radio, and every GATT procedure advances the
+// simulated clock by the round trips it needs, so the drivers can be timed without scales on the bench.
+
+#define BLE_HCI_ADV_TYPE_ADV_IND 0
+#define BLE_HCI_ADV_TYPE_ADV_SCAN_IND 2
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   Addresses and UUIDs    ----------------------------------
+// ---------------------------------------------------------------------------------------
+
+// Kept as a lowercase 128-bit string, 16 and 32-bit UUIDs are expanded with the Bluetooth base UUID.
+class NimBLEUUID {
+public:
+  NimBLEUUID() {}
+  NimBLEUUID(const char* value) : NimBLEUUID(std::string(value)) {}
+  NimBLEUUID(const std::string& value) {
+    for (char c : value) {
+      this->value += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (this->value.size() == 4) {
+      this->value = "0000" + this->value;
+    }
+    if (this->value.size() == 8) {
+      this->value += "-0000-1000-8000-00805f9b34fb";
+    }
+  }
+  NimBLEUUID(uint16_t value) {
+    char buffer[9];
+    snprintf(buffer, sizeof(buffer), "%04x", value);
+    *this = NimBLEUUID(std::string(buffer));
+  }
+  bool equals(const NimBLEUUID& other) const { return value == other.value; }
+  bool operator==(const NimBLEUUID& other) const { return equals(other); }
+  std::string toString() const { return value; }
+
+private:
+  std::string value;
+};
+
+class NimBLEAddress {
+public:
+  NimBLEAddress() {}
+  NimBLEAddress(uint64_t address) {
+    for (size_t i = 0; i < 6; i++) {
+      native[i] = static_cast<uint8_t>(address >> (8 * i));
+    }
+  }
+  const uint8_t* getNative() const { return native; }
+  std::string toString() const {
+    char buffer[18];
+    snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+      native[5], native[4], native[3], native[2], native[1], native[0]);
+    return buffer;
+  }
+  bool operator==(const NimBLEAddress& other) const { return memcmp(native, other.native, 6) == 0; }
+
+private:
+  uint8_t native[6] = {};
+};
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   Simulated peers    --------------------------------------
+// ---------------------------------------------------------------------------------------
+class NimBLEClient;
+
+namespace sim {
+
+// How long the central waits for each kind of GATT procedure.
+struct LinkDelays {
+  uint32_t connectMs = 60;               // Connection established and MTU exchanged
+  uint32_t discoveryRoundTripMs = 30;    // One discovery request, for a service, characteristic or descriptor
+  uint32_t writeWithResponseMs = 30;     // Write request until its response, CCCD writes included
+  uint32_t notificationIntervalMs = 100; // How often the scale sends the weight once it streams
+};
+
+struct CharacteristicSpec {
+  NimBLEUUID uuid;
+  bool canNotify = false;
+  bool canIndicate = false;
+  bool canWrite = true;
+};
+
+struct ServiceSpec {
+  NimBLEUUID uuid;
+  std::vector<CharacteristicSpec> characteristics;
+};
+
+// A scale as seen over the air. It streams the weight on weightCharacteristic once the central enabled
+// its notifications or indications and, if startCommand isn't empty, wrote a value containing startCommand.
+struct Peer {
+  std::string name;
+  NimBLEAddress address;
+  std::vector<ServiceSpec> services;
+  NimBLEUUID weightCharacteristic;
+  std::vector<uint8_t> startCommand;
+  std::function<std::vector<uint8_t>(int32_t weightMg)> encodeWeight;
+  int32_t weightMg = 12300;
+  uint16_t mtu = 185;
+
+  const ServiceSpec* findService(const NimBLEUUID& uuid) const {
+    for (const auto& service : services) {
+      if (service.uuid == uuid) {
+        return &service;
+      }
+    }
+    return nullptr;
+  }
+};
+
+struct LinkStats {
+  uint32_t discoveries = 0;         // Discovery round trips, including lookups of attributes the peer doesn't have
+  uint32_t writesWithResponse = 0;
+  uint32_t writesWithoutResponse = 0;
+  uint32_t notifications = 0;
+};
+
+// The air between the clients and the peers. Single threaded: notifications are delivered by advanceTo(),
+// from the caller's thread, while blocking GATT procedures only move the clock.
+class Link {
+public:
+  static Link& get() {
+    static Link link;
+    return link;
+  }
+
+  LinkDelays delays;
+  LinkStats stats;
+
+  void addPeer(Peer* peer) { peers.push_back(peer); }
+  void removePeer(Peer* peer) { peers.erase(std::remove(peers.begin(), peers.end(), peer), peers.end()); }
+  Peer* findPeer(const NimBLEAddress& address) {
+    for (Peer* peer : peers) {
+      if (peer->address == address) {
+        return peer;
+      }
+    }
+    return nullptr;
+  }
+
+  void wait(uint32_t ms) { clockMs += ms; }
+  // Moves the clock to timeMs, delivering the notifications due by then in order.
+  void advanceTo(uint32_t timeMs);
+  // When the next notification is due, UINT32_MAX if none is.
+  uint32_t nextEventAt() const;
+  // The peer ends its connections, as a scale does when it's switched off or gives up on the central.
+  void dropPeer(Peer* peer);
+
+private:
+  friend class ::NimBLEClient;
+  std::vector<Peer*> peers;
+  std::vector<NimBLEClient*> connectedClients;
+};
+
+}  // namespace sim
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   GATT client    ------------------------------------------
+// ---------------------------------------------------------------------------------------
+class NimBLERemoteCharacteristic;
+class NimBLERemoteService;
+using notify_callback = std::function<void(NimBLERemoteCharacteristic*, uint8_t*, size_t, bool)>;
+
+class NimBLERemoteDescriptor {
+public:
+  NimBLERemoteDescriptor(NimBLERemoteCharacteristic* characteristic, const NimBLEUUID& uuid) : characteristic(characteristic), uuid(uuid) {}
+  NimBLEUUID getUUID() { return uuid; }
+  bool writeValue(const uint8_t* data, size_t length, bool response = false);
+
+private:
+  NimBLERemoteCharacteristic* characteristic;
+  NimBLEUUID uuid;
+};
+
+class NimBLERemoteCharacteristic {
+public:
+  NimBLERemoteCharacteristic(NimBLERemoteService* service, const sim::CharacteristicSpec& spec, uint16_t handle)
+    : service(service), spec(spec), handle(handle) {}
+  NimBLEUUID getUUID() { return spec.uuid; }
+  uint16_t getHandle() { return handle; }
+  NimBLERemoteService* getRemoteService() { return service; }
+  bool canNotify() { return spec.canNotify; }
+  bool canIndicate() { return spec.canIndicate; }
+  bool canWrite() { return spec.canWrite; }
+  bool canRead() { return false; }
+
+  NimBLERemoteDescriptor* getDescriptor(const NimBLEUUID& uuid);
+  bool writeValue(const uint8_t* data, size_t length, bool response = false);
+  std::string readValue() { return ""; }
+  bool subscribe(bool notifications = true, notify_callback callback = nullptr, bool response = false);
+  bool unsubscribe(bool response = false);
+
+private:
+  friend class NimBLERemoteDescriptor;
+  friend class NimBLEClient;
+  NimBLERemoteService* service;
+  sim::CharacteristicSpec spec;
+  uint16_t handle;
+  std::vector<std::unique_ptr<NimBLERemoteDescriptor>> descriptors;
+  notify_callback callback = nullptr;
+  bool cccdEnabled = false;
+  void setCccd(bool enabled);
+};
+
+class NimBLERemoteService {
+public:
+  NimBLERemoteService(NimBLEClient* client, const sim::ServiceSpec& spec) : client(client), spec(spec) {}
+  NimBLEUUID getUUID() { return spec.uuid; }
+  NimBLEClient* getClient() { return client; }
+  NimBLERemoteCharacteristic* getCharacteristic(const NimBLEUUID& uuid);
+
+private:
+  friend class NimBLEClient;
+  NimBLEClient* client;
+  sim::ServiceSpec spec;
+  std::vector<std::unique_ptr<NimBLERemoteCharacteristic>> characteristics;
+};
+
+class NimBLEConnInfo {
+public:
+  NimBLEConnInfo(uint16_t interval, uint16_t latency, uint16_t timeout) : interval(interval), latency(latency), timeout(timeout) {}
+  uint16_t getConnInterval() { return interval; }
+  uint16_t getConnLatency() { return latency; }
+  uint16_t getConnTimeout() { return timeout; }
+
+private:
+  uint16_t interval;
+  uint16_t latency;
+  uint16_t timeout;
+};
+
+class NimBLEClientCallbacks {
+public:
+  virtual ~NimBLEClientCallbacks() {}
+  virtual void onConnect(NimBLEClient* client) {}
+  virtual void onDisconnect(NimBLEClient* client) {}
+};
+
+class NimBLEClient {
+public:
+  // NimBLE's defaults until setConnectionParams() is called.
+  static constexpr uint16_t DEFAULT_MIN_INTERVAL = 24;
+  static constexpr uint16_t DEFAULT_MAX_INTERVAL = 40;
+  static constexpr uint16_t DEFAULT_SUPERVISION_TIMEOUT = 256;
+
+  explicit NimBLEClient(const NimBLEAddress& address) : peerAddress(address) {}
+  ~NimBLEClient() { disconnect(); }
+
+  bool connect(bool deleteAttributes = true);
+  int disconnect(uint8_t reason = 0x13);
+  bool isConnected() { return connected; }
+  NimBLERemoteService* getService(const NimBLEUUID& uuid);
+  void setClientCallbacks(NimBLEClientCallbacks* callbacks, bool deleteCallbacks = true) { this->callbacks = callbacks; }
+  void setConnectionParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout,
+    uint16_t scanInterval = 16, uint16_t scanWindow = 16) {
+    this->minInterval = minInterval;
+    this->maxInterval = maxInterval;
+    this->latency = latency;
+    this->timeout = timeout;
+  }
+  void updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+    setConnectionParams(minInterval, maxInterval, latency, timeout);
+  }
+  // The peer settles for the longest interval it was offered.
+  NimBLEConnInfo getConnInfo() { return NimBLEConnInfo(maxInterval, latency, timeout); }
+  uint16_t getMTU();
+  uint16_t getConnId() { return connected ? 1 : 0xFFFF; }
+  NimBLEAddress getPeerAddress() { return peerAddress; }
+  void setPeerAddress(const NimBLEAddress& address) { peerAddress = address; }
+
+private:
+  friend class NimBLERemoteService;
+  friend class NimBLERemoteCharacteristic;
+  friend class sim::Link;
+  NimBLEAddress peerAddress;
+  sim::Peer* peer = nullptr;
+  bool connected = false;
+  NimBLEClientCallbacks* callbacks = nullptr;
+  uint16_t minInterval = DEFAULT_MIN_INTERVAL;
+  uint16_t maxInterval = DEFAULT_MAX_INTERVAL;
+  uint16_t latency = 0;
+  uint16_t timeout = DEFAULT_SUPERVISION_TIMEOUT;
+  std::vector<std::unique_ptr<NimBLERemoteService>> services;
+  uint16_t nextHandle = 1;
+
+  // The peer's side of the connection.
+  bool startCommandReceived = false;
+  bool streaming = false;
+  uint32_t nextNotificationAt = 0;
+  NimBLERemoteCharacteristic* findWeightCharacteristic();
+  void peerReceivedWrite(const uint8_t* data, size_t length);
+  void updateStream();
+  void notifyWeight();
+};
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   Scanning and device    ----------------------------------
+// ---------------------------------------------------------------------------------------
+class NimBLEAdvertisedDevice {
+public:
+  NimBLEAdvertisedDevice(const std::string& name, const NimBLEAddress& address, const std::string& manufacturerData = "")
+    : name(name), address(address), manufacturerData(manufacturerData) {}
+  std::string getName() { return name; }
+  NimBLEAddress getAddress() { return address; }
+  std::string getManufacturerData() { return manufacturerData; }
+  bool haveManufacturerData() { return !manufacturerData.empty(); }
+  bool haveName() { return !name.empty(); }
+  int getRSSI() { return -60; }
+  uint8_t getAdvType() { return BLE_HCI_ADV_TYPE_ADV_IND; }
+  bool isAdvertisingService(const NimBLEUUID& uuid) { return false; }
+
+private:
+  std::string name;
+  NimBLEAddress address;
+  std::string manufacturerData;
+};
+
+class NimBLEAdvertisedDeviceCallbacks {
+public:
+  virtual ~NimBLEAdvertisedDeviceCallbacks() {}
+  virtual void onResult(NimBLEAdvertisedDevice* advertisedDevice) {}
+};
+
+// Scanning isn't simulated.
+class NimBLEScan {
+public:
+  void setAdvertisedDeviceCallbacks(NimBLEAdvertisedDeviceCallbacks* callbacks, bool wantDuplicates = false) {}
+  void setInterval(uint16_t intervalMs) {}
+  void setWindow(uint16_t windowMs) {}
+  void setMaxResults(uint8_t maxResults) {}
+  void setDuplicateFilter(bool enabled) {}
+  void setActiveScan(bool active) {}
+  bool start(uint32_t duration, void (*onComplete)(std::vector<int>) = nullptr, bool continueResults = false) { return true; }
+  bool stop() { return true; }
+  void clearResults() {}
+};
+
+class NimBLEDevice {
+public:
+  static NimBLEScan* getScan() { return &scan; }
+  static NimBLEClient* createClient(NimBLEAddress address) { return new NimBLEClient(address); }
+  static bool deleteClient(NimBLEClient* client) {
+    delete client;
+    return true;
+  }
+  static void setMTU(uint16_t mtu) { preferredMtu = mtu; }
+  static uint16_t getMTU() { return preferredMtu; }
+  static void deinit(bool clearAll = false) {}
+
+private:
+  static inline NimBLEScan scan;
+  static inline uint16_t preferredMtu = 255;
+};
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   Implementation    ---------------------------------------
+// ---------------------------------------------------------------------------------------
+
+inline bool NimBLERemoteDescriptor::writeValue(const uint8_t* data, size_t length, bool response) {
+  NimBLEClient* client = characteristic->getRemoteService()->getClient();
+  if (!client->isConnected()) {
+    return false;
+  }
+  sim::Link& link = sim::Link::get();
+  if (response) {
+    link.stats.writesWithResponse++;
+    link.wait(link.delays.writeWithResponseMs);
+  }
+  else {
+    link.stats.writesWithoutResponse++;
+  }
+  if (uuid == NimBLEUUID(static_cast<uint16_t>(0x2902))) {
+    characteristic->setCccd(length > 0 && (data[0] != 0 || (length > 1 && data[1] != 0)));
+  }
+  return true;
+}
+
+inline NimBLERemoteDescriptor* NimBLERemoteCharacteristic::getDescriptor(const NimBLEUUID& uuid) {
+  for (const auto& descriptor : descriptors) {
+    if (descriptor->getUUID() == uuid) {
+      return descriptor.get();
+    }
+  }
+  sim::Link& link = sim::Link::get();
+  link.stats.discoveries++;
+  link.wait(link.delays.discoveryRoundTripMs);
+  // Only the CCCD is simulated.
+  if (!(uuid == NimBLEUUID(static_cast<uint16_t>(0x2902))) || !(spec.canNotify || spec.canIndicate)) {
+    return nullptr;
+  }
+  descriptors.push_back(std::make_unique<NimBLERemoteDescriptor>(this, uuid));
+  return descriptors.back().get();
+}
+
+inline bool NimBLERemoteCharacteristic::writeValue(const uint8_t* data, size_t length, bool response) {
+  NimBLEClient* client = service->getClient();
+  if (!client->isConnected()) {
+    return false;
+  }
+  sim::Link& link = sim::Link::get();
+  if (response) {
+    link.stats.writesWithResponse++;
+    link.wait(link.delays.writeWithResponseMs);
+  }
+  else {
+    link.stats.writesWithoutResponse++;
+  }
+  client->peerReceivedWrite(data, length);
+  return true;
+}
+
+inline bool NimBLERemoteCharacteristic::subscribe(bool notifications, notify_callback callback, bool response) {
+  NimBLERemoteDescriptor* cccd = getDescriptor(NimBLEUUID(static_cast<uint16_t>(0x2902)));
+  if (cccd == nullptr) {
+    return false;
+  }
+  this->callback = callback;
+  uint8_t value[2] = { static_cast<uint8_t>(notifications ? 0x01 : 0x02), 0x00 };
+  return cccd->writeValue(value, 2, response);
+}
+
+inline bool NimBLERemoteCharacteristic::unsubscribe(bool response) {
+  NimBLERemoteDescriptor* cccd = getDescriptor(NimBLEUUID(static_cast<uint16_t>(0x2902)));
+  if (cccd == nullptr) {
+    return false;
+  }
+  uint8_t value[2] = { 0x00, 0x00 };
+  callback = nullptr;
+  return cccd->writeValue(value, 2, response);
+}
+
+inline void NimBLERemoteCharacteristic::setCccd(bool enabled) {
+  cccdEnabled = enabled;
+  service->getClient()->updateStream();
+}
+
+inline NimBLERemoteCharacteristic* NimBLERemoteService::getCharacteristic(const NimBLEUUID& uuid) {
+  for (const auto& characteristic : characteristics) {
+    if (characteristic->getUUID() == uuid) {
+      return characteristic.get();
+    }
+  }
+  sim::Link& link = sim::Link::get();
+  link.stats.discoveries++;
+  link.wait(link.delays.discoveryRoundTripMs);
+  for (const auto& characteristic : spec.characteristics) {
+    if (characteristic.uuid == uuid) {
+      characteristics.push_back(std::make_unique<NimBLERemoteCharacteristic>(this, characteristic, client->nextHandle++));
+      return characteristics.back().get();
+    }
+  }
+  return nullptr;
+}
+
+inline bool NimBLEClient::connect(bool deleteAttributes) {
+  if (connected) {
+    return true;
+  }
+  if (deleteAttributes) {
+    services.clear();
+    nextHandle = 1;
+  }
+  sim::Link& link = sim::Link::get();
+  link.wait(link.delays.connectMs);
+  peer = link.findPeer(peerAddress);
+  if (peer == nullptr) {
+    return false;
+  }
+  connected = true;
+  startCommandReceived = false;
+  streaming = false;
+  for (const auto& service : services) {
+    for (const auto& characteristic : service->characteristics) {
+      characteristic->cccdEnabled = false;
+    }
+  }
+  link.connectedClients.push_back(this);
+  if (callbacks != nullptr) {
+    callbacks->onConnect(this);
+  }
+  return true;
+}
+
+inline int NimBLEClient::disconnect(uint8_t reason) {
+  if (!connected) {
+    return 0;
+  }
+  connected = false;
+  streaming = false;
+  peer = nullptr;
+  auto& clients = sim::Link::get().connectedClients;
+  clients.erase(std::remove(clients.begin(), clients.end(), this), clients.end());
+  if (callbacks != nullptr) {
+    callbacks->onDisconnect(this);
+  }
+  return 0;
+}
+
+inline NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
+  if (!connected) {
+    return nullptr;
+  }
+  for (const auto& service : services) {
+    if (service->getUUID() == uuid) {
+      return service.get();
+    }
+  }
+  sim::Link& link = sim::Link::get();
+  link.stats.discoveries++;
+  link.wait(link.delays.discoveryRoundTripMs);
+  const sim::ServiceSpec* spec = peer->findService(uuid);
+  if (spec == nullptr) {
+    return nullptr;
+  }
+  services.push_back(std::make_unique<NimBLERemoteService>(this, *spec));
+  return services.back().get();
+}
+
+inline uint16_t NimBLEClient::getMTU() {
+  return connected ? std::min(peer->mtu, NimBLEDevice::getMTU()) : 0;
+}
+
+inline NimBLERemoteCharacteristic* NimBLEClient::findWeightCharacteristic() {
+  for (const auto& service : services) {
+    for (const auto& characteristic : service->characteristics) {
+      if (characteristic->getUUID() == peer->weightCharacteristic) {
+        return characteristic.get();
+      }
+    }
+  }
+  return nullptr;
+}
+
+inline void NimBLEClient::peerReceivedWrite(const uint8_t* data, size_t length) {
+  const auto& command = peer->startCommand;
+  if (!command.empty() && std::search(data, data + length, command.begin(), command.end()) != data + length) {
+    startCommandReceived = true;
+    updateStream();
+  }
+}
+
+// The scale's first weight comes half a notification interval after it starts streaming, on average.
+inline void NimBLEClient::updateStream() {
+  NimBLERemoteCharacteristic* characteristic = findWeightCharacteristic();
+  bool subscribed = characteristic != nullptr && characteristic->cccdEnabled;
+  bool started = subscribed && (peer->startCommand.empty() || startCommandReceived);
+  if (started && !streaming) {
+    nextNotificationAt = millis() + sim::Link::get().delays.notificationIntervalMs / 2;
+  }
+  streaming = started;
+}
+
+inline void NimBLEClient::notifyWeight() {
+  NimBLERemoteCharacteristic* characteristic = findWeightCharacteristic();
+  if (characteristic == nullptr || characteristic->callback == nullptr) {
+    return;
+  }
+  sim::Link::get().stats.notifications++;
+  std::vector<uint8_t> data = peer->encodeWeight(peer->weightMg);
+  characteristic->callback(characteristic, data.data(), data.size(), characteristic->spec.canNotify);
+}
+
+inline uint32_t sim::Link::nextEventAt() const {
+  uint32_t next = UINT32_MAX;
+  for (NimBLEClient* client : connectedClients) {
+    if (client->streaming) {
+      next = std::min(next, client->nextNotificationAt);
+    }
+  }
+  return next;
+}
+
+inline void sim::Link::advanceTo(uint32_t timeMs) {
+  for (uint32_t next = nextEventAt(); next <= timeMs; next = nextEventAt()) {
+    clockMs = std::max(clockMs, next);
+    for (NimBLEClient* client : connectedClients) {
+      if (client->streaming && client->nextNotificationAt == next) {
+        client->nextNotificationAt += delays.notificationIntervalMs;
+        client->notifyWeight();
+        break;
+      }
+    }
+  }
+  clockMs = std::max(clockMs, timeMs);
+}
+
+inline void sim::Link::dropPeer(Peer* peer) {
+  std::vector<NimBLEClient*> clients = connectedClients;
+  for (NimBLEClient* client : clients) {
+    if (client->peer == peer) {
+      client->disconnect(0x08);
+    }
+  }
+}
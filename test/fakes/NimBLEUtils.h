@@ -0,0 +1,15 @@
+#pragma once
+#include "NimBLEDevice.h"
+
+class NimBLEUtils {
+public:
+  // Like NimBLE, allocates the string when target is nullptr.
+  static char* buildHexData(uint8_t* target, const uint8_t* source, uint8_t length) {
+    char* hex = target != nullptr ? reinterpret_cast<char*>(target) : static_cast<char*>(malloc(length * 2 + 1));
+    for (uint8_t i = 0; i < length; i++) {
+      snprintf(hex + i * 2, 3, "%02x", source[i]);
+    }
+    hex[length * 2] = '\0';
+    return hex;
+  }
+};
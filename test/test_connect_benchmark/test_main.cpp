@@ -0,0 +1,453 @@
+#include <unity.h>
+#include "remote_scales.h"
+#include "remote_scales_plugin_registry.h"
+#include "connect_timing.h"
+#include "scales/acaia.h"
+#include "scales/bookoo.h"
+#include "scales/decent.h"
+#include "scales/difluid.h"
+#include "scales/eclair.h"
+#include "scales/eureka.h"
+#include "scales/felicitaScale.h"
+#include "scales/timemore.h"
+#include "scales/varia.h"
+
+// Time from connect() to the first weight of every plugin, against simulated scales. Each peer looks like
+// the real scale as far as its driver can tell: the same services and characteristics, and weight
+// notifications in the scale's format once the driver did what that scale needs before it streams.
+// Run with `pio test -e native -v` to see the tables.
+
+namespace {
+
+constexpr uint32_t TIMEOUT_MS = 10000;
+constexpr uint32_t UPDATE_INTERVAL_MS = 10;  // How often the application calls update()
+
+struct ScaleUnderTest {
+  sim::Peer peer;
+  uint32_t budgetMs;  // Time to first weight on the default link, taking longer is a regression
+};
+
+struct Measurement {
+  std::string pluginId;
+  bool connected = false;
+  bool gotWeight = false;
+  uint32_t timeToFirstWeightMs = 0;
+  sim::LinkStats linkStats;
+};
+
+uint8_t xorOf(const std::vector<uint8_t>& bytes, size_t from, size_t to) {
+  uint8_t result = 0;
+  for (size_t i = from; i < to; i++) {
+    result ^= bytes[i];
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   Simulated scales    -------------------------------------
+// ---------------------------------------------------------------------------------------
+
+std::vector<uint8_t> acaiaMessage(uint8_t type, const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> message = { 0xEF, 0xDD, type };
+  message.insert(message.end(), payload.begin(), payload.end());
+  uint8_t checksums[2] = {};
+  for (size_t i = 0; i < payload.size(); i++) {
+    checksums[i % 2] += payload[i];
+  }
+  message.push_back(checksums[0]);
+  message.push_back(checksums[1]);
+  return message;
+}
+
+// Streams once it got the notification request, which follows the identification in the same write.
+ScaleUnderTest acaia() {
+  sim::Peer peer;
+  peer.name = "LUNAR-2A3B4C";
+  peer.address = NimBLEAddress(0x0A0000000001);
+  peer.services = { { "49535343-fe7d-4ae5-8fa9-9fafd205e455", {
+    { .uuid = "49535343-1e4d-4bd9-ba61-23c647249616", .canNotify = true, .canWrite = false },
+    { .uuid = "49535343-8841-43f4-a8d4-ecbe34729bb3" },
+  } } };
+  peer.weightCharacteristic = "49535343-1e4d-4bd9-ba61-23c647249616";
+  peer.startCommand = { 0xEF, 0xDD, 0x0C };
+  peer.encodeWeight = [](int32_t weightMg) {
+    int32_t value = weightMg / 100;
+    return acaiaMessage(0x0C, { 8, 0x05, static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8), 0, 0, 1, 0 });
+  };
+  return { peer, 400 };
+}
+
+ScaleUnderTest acaiaUmbra() {
+  sim::Peer peer;
+  peer.name = "UMBRA-2A3B4C";
+  peer.address = NimBLEAddress(0x0A0000000002);
+  peer.services = { { "0000fe40-cc7a-482a-984a-7f2ed5b3e58f", {
+    { .uuid = "0000fe41-8e22-4541-9d4c-21edae82ed19" },
+    { .uuid = "0000fe42-8e22-4541-9d4c-21edae82ed19", .canNotify = true, .canWrite = false },
+  } } };
+  peer.weightCharacteristic = "0000fe42-8e22-4541-9d4c-21edae82ed19";
+  peer.startCommand = { 0xEF, 0xDD, 0x0C };
+  peer.encodeWeight = [](int32_t weightMg) {
+    int32_t value = weightMg / 100;
+    return acaiaMessage(0x0C, { 8, 0x05, 0, 0, static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value), 1, 0 });
+  };
+  return { peer, 400 };
+}
+
+ScaleUnderTest bookoo() {
+  sim::Peer peer;
+  peer.name = "BOOKOO_SC 1234";
+  peer.address = NimBLEAddress(0x0A0000000003);
+  peer.services = { { "0FFE", {
+    { .uuid = "FF11", .canNotify = true, .canWrite = false },
+    { .uuid = "FF12" },
+  } } };
+  peer.weightCharacteristic = "FF11";
+  peer.encodeWeight = [](int32_t weightMg) {
+    int32_t value = weightMg / 10;
+    std::vector<uint8_t> message(20, 0);
+    message[0] = 0x03;
+    message[1] = 0x0B;
+    message[6] = '+';
+    message[7] = value >> 16;
+    message[8] = value >> 8;
+    message[9] = value;
+    message[19] = xorOf(message, 0, 19);
+    return message;
+  };
+  return { peer, 325 };
+}
+
+ScaleUnderTest decent() {
+  sim::Peer peer;
+  peer.name = "Decent Scale";
+  peer.address = NimBLEAddress(0x0A0000000004);
+  peer.services = { { "FFF0", {
+    { .uuid = "FFF4", .canNotify = true, .canWrite = false },
+    { .uuid = "36F5" },
+  } } };
+  peer.weightCharacteristic = "FFF4";
+  peer.encodeWeight = [](int32_t weightMg) {
+    int16_t value = weightMg / 100;
+    std::vector<uint8_t> message = { 0x03, 0xCE, static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value), 0, 0, 0 };
+    message[6] = xorOf(message, 0, 6);
+    return message;
+  };
+  return { peer, 300 };
+}
+
+// Streams once auto notifications are enabled.
+ScaleUnderTest difluid() {
+  sim::Peer peer;
+  peer.name = "Microbalance";
+  peer.address = NimBLEAddress(0x0A0000000005);
+  peer.services = { { "00EE", {
+    { .uuid = "AA01", .canNotify = true },
+  } } };
+  peer.weightCharacteristic = "AA01";
+  peer.startCommand = { 0xDF, 0xDF, 0x01, 0x00, 0x01, 0x01 };
+  peer.encodeWeight = [](int32_t weightMg) {
+    int32_t value = weightMg / 100;
+    std::vector<uint8_t> message = { 0xDF, 0xDF, 0x03, 0x00, 13,
+      static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) };
+    message.resize(5 + 13, 0);
+    uint8_t checksum = 0;
+    for (uint8_t byte : message) {
+      checksum += byte;
+    }
+    message.push_back(checksum);
+    return message;
+  };
+  return { peer, 325 };
+}
+
+ScaleUnderTest eclair() {
+  sim::Peer peer;
+  peer.name = "ECLAIR-1234";
+  peer.address = NimBLEAddress(0x0A0000000006);
+  peer.services = { { "B905EAEA-2E63-0E04-7582-7913F10D8F81", {
+    { .uuid = "AD736C5F-BBC9-1F96-D304-CB5D5F41E160", .canNotify = true, .canWrite = false },
+    { .uuid = "4F9A45BA-8E1B-4E07-E157-0814D393B968", .canNotify = true },
+  } } };
+  peer.weightCharacteristic = "AD736C5F-BBC9-1F96-D304-CB5D5F41E160";
+  peer.encodeWeight = [](int32_t weightMg) {
+    std::vector<uint8_t> message(10, 0);
+    message[0] = 0x57;
+    memcpy(&message[1], &weightMg, 4);
+    message[9] = xorOf(message, 1, 9);
+    return message;
+  };
+  return { peer, 300 };
+}
+
+ScaleUnderTest eureka() {
+  sim::Peer peer;
+  peer.name = "CFS-9002";
+  peer.address = NimBLEAddress(0x0A0000000007);
+  peer.services = { { "FFF0", {
+    { .uuid = "FFF1", .canNotify = true, .canWrite = false },
+    { .uuid = "FFF2" },
+  } } };
+  peer.weightCharacteristic = "FFF1";
+  peer.encodeWeight = [](int32_t weightMg) {
+    int32_t value = weightMg / 100;
+    std::vector<uint8_t> message(11, 0);
+    message[7] = value;
+    message[8] = value >> 8;
+    return message;
+  };
+  return { peer, 300 };
+}
+
+ScaleUnderTest felicita() {
+  sim::Peer peer;
+  peer.name = "FELICITA";
+  peer.address = NimBLEAddress(0x0A0000000008);
+  peer.services = { { "FFE0", {
+    { .uuid = "FFE1", .canNotify = true },
+  } } };
+  peer.weightCharacteristic = "FFE1";
+  peer.encodeWeight = [](int32_t weightMg) {
+    char digits[8];
+    snprintf(digits, sizeof(digits), "%06d", static_cast<int>(abs(weightMg) / 10));
+    std::vector<uint8_t> message(18, 0);
+    message[0] = 0x01;
+    message[1] = 0x02;
+    message[2] = weightMg < 0 ? '-' : '+';
+    memcpy(&message[3], digits, 6);
+    return message;
+  };
+  return { peer, 250 };
+}
+
+// Streams once indications are enabled and it got the weight request.
+ScaleUnderTest timemore() {
+  sim::Peer peer;
+  peer.name = "Timemore Scale";
+  peer.address = NimBLEAddress(0x0A0000000009);
+  peer.services = { { "181D", {
+    { .uuid = "2A9D", .canNotify = true, .canIndicate = true },
+    { .uuid = "553f4e49-bf21-4468-9c6c-0e4fb5b17697" },
+  } } };
+  peer.weightCharacteristic = "2A9D";
+  peer.startCommand = { 0x02, 0x00 };
+  peer.encodeWeight = [](int32_t weightMg) {
+    int32_t value = weightMg / 100;
+    std::vector<uint8_t> message(9, 0);
+    message[0] = 0x10;
+    memcpy(&message[5], &value, 4);
+    return message;
+  };
+  return { peer, 375 };
+}
+
+ScaleUnderTest varia() {
+  sim::Peer peer;
+  peer.name = "AKU MINI SCALE";
+  peer.address = NimBLEAddress(0x0A000000000A);
+  peer.services = { { "FFF0", {
+    { .uuid = "FFF1", .canNotify = true, .canWrite = false },
+    { .uuid = "FFF2" },
+  } } };
+  peer.weightCharacteristic = "FFF1";
+  peer.encodeWeight = [](int32_t weightMg) {
+    int32_t value = weightMg / 10;
+    std::vector<uint8_t> message = { 0xFA, 0x01, 0x03,
+      static_cast<uint8_t>((value >> 16) & 0x0F), static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value), 0 };
+    message[6] = xorOf(message, 1, 6);
+    return message;
+  };
+  return { peer, 300 };
+}
+
+std::vector<ScaleUnderTest> allScales() {
+  return { acaia(), acaiaUmbra(), bookoo(), decent(), difluid(), eclair(), eureka(), felicita(), timemore(), varia() };
+}
+
+// ---------------------------------------------------------------------------------------
+// ---------------------------   Benchmark    --------------------------------------------
+// ---------------------------------------------------------------------------------------
+
+// Connects like an application would and keeps calling update() until the first weight arrives.
+Measurement measure(sim::Peer& peer, const sim::LinkDelays& delays) {
+  sim::Link& link = sim::Link::get();
+  link.delays = delays;
+  link.stats = sim::LinkStats();
+  link.addPeer(&peer);
+
+  Measurement measurement;
+  NimBLEAdvertisedDevice advertisedDevice(peer.name, peer.address);
+  std::unique_ptr<RemoteScales> scales = RemoteScalesFactory::getInstance()->create(DiscoveredDevice(&advertisedDevice));
+  if (scales != nullptr) {
+    measurement.pluginId = scales->getPluginId();
+    uint32_t startedAt = millis();
+    measurement.connected = scales->connect();
+    while (measurement.connected && scales->getSnapshot().timestamp == 0 && millis() - startedAt < TIMEOUT_MS) {
+      link.advanceTo(std::min(link.nextEventAt(), millis() + UPDATE_INTERVAL_MS));
+      scales->update();
+    }
+    ScaleSnapshot snapshot = scales->getSnapshot();
+    measurement.gotWeight = snapshot.timestamp != 0 && snapshot.weightMg == peer.weightMg;
+    measurement.timeToFirstWeightMs = snapshot.timestamp - startedAt;
+  }
+  measurement.linkStats = link.stats;
+
+  scales.reset();
+  link.removePeer(&peer);
+  return measurement;
+}
+
+void printTable(const char* title, const std::vector<ScaleUnderTest>& scales, const std::vector<Measurement>& measurements) {
+  printf("\n%s\n", title);
+  printf("scale            plugin            first weight ms  discoveries  acked writes  writes\n");
+  for (size_t i = 0; i < scales.size(); i++) {
+    const Measurement& measurement = measurements[i];
+    if (measurement.gotWeight) {
+      printf("%-16s %-17s %15u", scales[i].peer.name.c_str(), measurement.pluginId.c_str(), measurement.timeToFirstWeightMs);
+    }
+    else {
+      printf("%-16s %-17s %15s", scales[i].peer.name.c_str(), measurement.pluginId.c_str(), "-");
+    }
+    printf(" %12u %13u %7u\n", measurement.linkStats.discoveries, measurement.linkStats.writesWithResponse,
+      measurement.linkStats.writesWithoutResponse);
+  }
+  printf("\n%s", ConnectTimingLog::getInstance()->formatReport().c_str());
+}
+
+std::vector<Measurement> measureAll(std::vector<ScaleUnderTest>& scales, const sim::LinkDelays& delays) {
+  std::vector<Measurement> measurements;
+  for (auto& scale : scales) {
+    measurements.push_back(measure(scale.peer, delays));
+  }
+  return measurements;
+}
+
+}  // namespace
+
+void setUp() {
+  AcaiaScalesPlugin::apply();
+  BookooScalesPlugin::apply();
+  DecentScalesPlugin::apply();
+  DifluidScalesPlugin::apply();
+  EclairScalesPlugin::apply();
+  EurekaScalesPlugin::apply();
+  FelicitaScalePlugin::apply();
+  TimemoreScalesPlugin::apply();
+  VariaScalesPlugin::apply();
+  ConnectTimingLog::getInstance()->clear();
+}
+
+void tearDown() {}
+
+void test_time_to_first_weight() {
+  std::vector<ScaleUnderTest> scales = allScales();
+  std::vector<Measurement> measurements = measureAll(scales, sim::LinkDelays());
+  printTable("Default link", scales, measurements);
+
+  for (size_t i = 0; i < scales.size(); i++) {
+    std::string name = scales[i].peer.name;
+    TEST_ASSERT_TRUE_MESSAGE(measurements[i].connected, (name + " didn't connect").c_str());
+    TEST_ASSERT_TRUE_MESSAGE(measurements[i].gotWeight, (name + " got no weight").c_str());
+    TEST_ASSERT_TRUE_MESSAGE(measurements[i].timeToFirstWeightMs <= scales[i].budgetMs,
+      (name + " took " + std::to_string(measurements[i].timeToFirstWeightMs) + "ms, the budget is "
+        + std::to_string(scales[i].budgetMs) + "ms").c_str());
+  }
+}
+
+// A long connection interval makes every round trip slower, the drivers must still get there.
+void test_time_to_first_weight_on_a_slow_link() {
+  sim::LinkDelays delays;
+  delays.connectMs = 200;
+  delays.discoveryRoundTripMs = 100;
+  delays.writeWithResponseMs = 100;
+  delays.notificationIntervalMs = 250;
+  std::vector<ScaleUnderTest> scales = allScales();
+  std::vector<Measurement> measurements = measureAll(scales, delays);
+  printTable("Slow link", scales, measurements);
+
+  for (size_t i = 0; i < scales.size(); i++) {
+    TEST_ASSERT_TRUE_MESSAGE(measurements[i].gotWeight, (scales[i].peer.name + " got no weight").c_str());
+  }
+}
+
+// Two Acaia scales updated from one loop take turns at their handshakes instead of connecting one after the other.
+void test_acaia_handshakes_overlap_on_one_task() {
+  sim::Link& link = sim::Link::get();
+  link.delays = sim::LinkDelays();
+  ScaleUnderTest lunar = acaia();
+  ScaleUnderTest umbra = acaiaUmbra();
+  link.addPeer(&lunar.peer);
+  link.addPeer(&umbra.peer);
+
+  NimBLEAdvertisedDevice lunarDevice(lunar.peer.name, lunar.peer.address);
+  NimBLEAdvertisedDevice umbraDevice(umbra.peer.name, umbra.peer.address);
+  std::unique_ptr<RemoteScales> lunarScales = RemoteScalesFactory::getInstance()->create(DiscoveredDevice(&lunarDevice));
+  std::unique_ptr<RemoteScales> umbraScales = RemoteScalesFactory::getInstance()->create(DiscoveredDevice(&umbraDevice));
+  uint32_t startedAt = millis();
+  TEST_ASSERT_TRUE(lunarScales->connect());
+  TEST_ASSERT_TRUE(umbraScales->connect());
+  // connect() returns once the link is up and the first slice of the handshake ran.
+  TEST_ASSERT_FALSE(lunarScales->isConnected());
+  TEST_ASSERT_EQUAL(0, lunarScales->getSnapshot().timestamp);
+
+  while ((lunarScales->getSnapshot().timestamp == 0 || umbraScales->getSnapshot().timestamp == 0) && millis() - startedAt < TIMEOUT_MS) {
+    link.advanceTo(std::min(link.nextEventAt(), millis() + UPDATE_INTERVAL_MS));
+    lunarScales->update();
+    umbraScales->update();
+  }
+  TEST_ASSERT_EQUAL(lunar.peer.weightMg, lunarScales->getSnapshot().weightMg);
+  TEST_ASSERT_EQUAL(umbra.peer.weightMg, umbraScales->getSnapshot().weightMg);
+  link.advanceTo(millis() + UPDATE_INTERVAL_MS);
+  lunarScales->update();
+  umbraScales->update();
+  TEST_ASSERT_TRUE(lunarScales->isConnected());
+  TEST_ASSERT_TRUE(umbraScales->isConnected());
+  // Less than the two handshakes in a row.
+  TEST_ASSERT_TRUE(millis() - startedAt < lunar.budgetMs + umbra.budgetMs);
+
+  lunarScales.reset();
+  umbraScales.reset();
+  link.removePeer(&lunar.peer);
+  link.removePeer(&umbra.peer);
+}
+
+// A scale that never answers the identification fails the handshake, which is retried like a failed connection.
+void test_acaia_handshake_timeout_reconnects() {
+  sim::Link& link = sim::Link::get();
+  link.delays = sim::LinkDelays();
+  ScaleUnderTest lunar = acaia();
+  lunar.peer.startCommand = { 0xFF };
+  link.addPeer(&lunar.peer);
+
+  NimBLEAdvertisedDevice device(lunar.peer.name, lunar.peer.address);
+  std::unique_ptr<RemoteScales> scales = RemoteScalesFactory::getInstance()->create(DiscoveredDevice(&device));
+  TEST_ASSERT_TRUE(scales->connect());
+  uint32_t startedAt = millis();
+  while (scales->getConnectionState() == ConnectionState::CONNECTED && millis() - startedAt < TIMEOUT_MS) {
+    link.advanceTo(millis() + UPDATE_INTERVAL_MS);
+    scales->update();
+  }
+  TEST_ASSERT_EQUAL(ConnectionState::RECONNECTING, scales->getConnectionState());
+  TEST_ASSERT_INT_WITHIN(100, 2000, millis() - startedAt);
+
+  // It streams once it gets what it wants, the next attempt gets there.
+  lunar.peer.startCommand = { 0xEF, 0xDD, 0x0C };
+  startedAt = millis();
+  while (scales->getSnapshot().timestamp == 0 && millis() - startedAt < TIMEOUT_MS) {
+    link.advanceTo(std::min(link.nextEventAt(), millis() + UPDATE_INTERVAL_MS));
+    scales->update();
+  }
+  TEST_ASSERT_EQUAL(lunar.peer.weightMg, scales->getSnapshot().weightMg);
+
+  scales.reset();
+  link.removePeer(&lunar.peer);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_time_to_first_weight);
+  RUN_TEST(test_time_to_first_weight_on_a_slow_link);
+  RUN_TEST(test_acaia_handshakes_overlap_on_one_task);
+  RUN_TEST(test_acaia_handshake_timeout_reconnects);
+  return UNITY_END();
+}
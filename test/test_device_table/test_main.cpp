@@ -0,0 +1,140 @@
+#include <unity.h>
+#include "device_table.h"
+#include <cstring>
+
+// DeviceTable decides which advertisers the scanner remembers, and so which scales getDiscoveredScales()
+// can still show once more devices are around than the table holds.
+
+namespace {
+
+struct Address {
+  uint8_t bytes[6];
+};
+
+Address address(uint8_t last) {
+  return Address{ { 0x0A, 0x00, 0x00, 0x00, 0x00, last } };
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_insert_and_find() {
+  DeviceTable table(4, 0);
+  Address first = address(1);
+  Address second = address(2);
+  DeviceTableEntry* entry = table.insert(first.bytes, -60, 100);
+
+  TEST_ASSERT_NOT_NULL(entry);
+  TEST_ASSERT_TRUE(entry == table.find(first.bytes));
+  TEST_ASSERT_NULL(table.find(second.bytes));
+  TEST_ASSERT_EQUAL(MatchResult::UNKNOWN, entry->match);
+  TEST_ASSERT_EQUAL(100, entry->firstSeen);
+  TEST_ASSERT_EQUAL(-60, entry->getRssi());
+  TEST_ASSERT_EQUAL(1, table.size());
+}
+
+void test_full_table_evicts_the_least_recently_seen_entry() {
+  DeviceTable table(3, 0);
+  Address addresses[4] = { address(1), address(2), address(3), address(4) };
+  table.insert(addresses[0].bytes, -60, 0);
+  table.insert(addresses[1].bytes, -60, 10);
+  table.insert(addresses[2].bytes, -60, 20);
+  table.touch(*table.find(addresses[0].bytes), -60, 30);
+
+  TEST_ASSERT_NOT_NULL(table.insert(addresses[3].bytes, -60, 40));
+  TEST_ASSERT_NULL(table.find(addresses[1].bytes));
+  TEST_ASSERT_NOT_NULL(table.find(addresses[0].bytes));
+  TEST_ASSERT_NOT_NULL(table.find(addresses[2].bytes));
+  TEST_ASSERT_EQUAL(3, table.size());
+}
+
+void test_eviction_skips_matched_scales() {
+  DeviceTable table(3, 0);
+  Address addresses[5] = { address(1), address(2), address(3), address(4), address(5) };
+  table.insert(addresses[0].bytes, -60, 0)->match = MatchResult::MATCHED;
+  table.insert(addresses[1].bytes, -60, 10)->match = MatchResult::NOT_MATCHED;
+  table.insert(addresses[2].bytes, -60, 20)->match = MatchResult::MATCHED;
+
+  // The matched scale seen first stays, the advertiser that isn't a scale makes room.
+  TEST_ASSERT_NOT_NULL(table.insert(addresses[3].bytes, -60, 30));
+  TEST_ASSERT_NOT_NULL(table.find(addresses[0].bytes));
+  TEST_ASSERT_NULL(table.find(addresses[1].bytes));
+
+  table.find(addresses[3].bytes)->match = MatchResult::MATCHED;
+  TEST_ASSERT_NULL(table.insert(addresses[4].bytes, -60, 40));
+  TEST_ASSERT_EQUAL(3, table.size());
+}
+
+void test_rssi_is_smoothed() {
+  DeviceTable table(4, 0);
+  Address first = address(1);
+  DeviceTableEntry* entry = table.insert(first.bytes, -60, 0);
+
+  // A quarter of the way towards each new reading.
+  table.touch(*entry, -80, 10);
+  TEST_ASSERT_EQUAL(-65, entry->getRssi());
+  table.touch(*entry, -80, 20);
+  TEST_ASSERT_EQUAL(-68, entry->getRssi());
+  for (uint32_t now = 30; now < 500; now += 10) {
+    table.touch(*entry, -80, now);
+  }
+  TEST_ASSERT_INT_WITHIN(1, -80, entry->getRssi());
+  TEST_ASSERT_EQUAL(490, entry->lastSeen);
+}
+
+void test_long_names_are_truncated() {
+  DeviceTable table(4, 0);
+  Address first = address(1);
+  DeviceTableEntry* entry = table.insert(first.bytes, -60, 0);
+
+  table.setName(*entry, "LUNAR-2A3B4C");
+  TEST_ASSERT_EQUAL_STRING("LUNAR-2A3B4C", entry->name);
+  table.setName(*entry, std::string(40, 'x'));
+  TEST_ASSERT_EQUAL(DeviceTableEntry::MAX_NAME_LENGTH, strlen(entry->name));
+  TEST_ASSERT_EQUAL_STRING(std::string(29, 'x').c_str(), entry->name);
+}
+
+void test_entries_expire() {
+  DeviceTable table(4, 1000);
+  Address addresses[2] = { address(1), address(2) };
+  table.insert(addresses[0].bytes, -60, 0);
+  table.insert(addresses[1].bytes, -60, 600);
+
+  size_t expired = 0;
+  table.expire(999, [&](const DeviceTableEntry& entry) { expired++; });
+  TEST_ASSERT_EQUAL(0, expired);
+
+  table.expire(1000, [&](const DeviceTableEntry& entry) {
+    TEST_ASSERT_EQUAL_MEMORY(addresses[0].bytes, entry.address, sizeof(entry.address));
+    expired++;
+  });
+  TEST_ASSERT_EQUAL(1, expired);
+  TEST_ASSERT_NULL(table.find(addresses[0].bytes));
+  TEST_ASSERT_NOT_NULL(table.find(addresses[1].bytes));
+}
+
+void test_no_expiry_by_default() {
+  DeviceTable table(4, 0);
+  Address first = address(1);
+  table.insert(first.bytes, -60, 0);
+
+  size_t expired = 0;
+  table.expire(3600000, [&](const DeviceTableEntry& entry) { expired++; });
+  TEST_ASSERT_EQUAL(0, expired);
+  TEST_ASSERT_EQUAL(1, table.size());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_insert_and_find);
+  RUN_TEST(test_full_table_evicts_the_least_recently_seen_entry);
+  RUN_TEST(test_eviction_skips_matched_scales);
+  RUN_TEST(test_rssi_is_smoothed);
+  RUN_TEST(test_long_names_are_truncated);
+  RUN_TEST(test_entries_expire);
+  RUN_TEST(test_no_expiry_by_default);
+  return UNITY_END();
+}
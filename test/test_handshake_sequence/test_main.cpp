@@ -0,0 +1,190 @@
+#include <unity.h>
+#include "handshake_sequence.h"
+#include <string>
+
+// The step sequencer behind the drivers' handshakes, on the simulated clock of test/fakes/Arduino.h.
+
+namespace {
+
+using State = HandshakeSequence::State;
+
+const uint8_t READY[] = { 0x01 };
+const uint8_t OTHER[] = { 0x02 };
+
+bool isReady(const uint8_t* data, size_t length) {
+  return length == 1 && data[0] == 0x01;
+}
+
+}  // namespace
+
+void setUp() {
+  sim::clockMs = 1000000;
+}
+
+void tearDown() {}
+
+void test_actions_run_in_order() {
+  std::string ran;
+  HandshakeSequence sequence;
+  sequence.addAction("a", [&]() { ran += "a"; return true; });
+  sequence.addAction("b", [&]() { ran += "b"; return true; });
+  TEST_ASSERT_EQUAL(State::IDLE, sequence.getState());
+
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::DONE, sequence.run(50));
+  TEST_ASSERT_EQUAL_STRING("ab", ran.c_str());
+  TEST_ASSERT_FALSE(sequence.getMillisUntilDeadline().has_value());
+
+  // Every start() runs the steps again.
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::DONE, sequence.run(50));
+  TEST_ASSERT_EQUAL_STRING("abab", ran.c_str());
+}
+
+void test_failed_action_stops_the_handshake() {
+  bool ranLast = false;
+  HandshakeSequence sequence;
+  sequence.addAction("discover", []() { return true; });
+  sequence.addAction("subscribe", []() { return false; });
+  sequence.addAction("identify", [&]() { ranLast = true; return true; });
+
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::FAILED, sequence.run(50));
+  TEST_ASSERT_EQUAL_STRING("subscribe", sequence.getStepName());
+  TEST_ASSERT_FALSE(ranLast);
+}
+
+void test_delay_waits_without_blocking() {
+  HandshakeSequence sequence;
+  sequence.addDelay("settle", 200);
+
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::RUNNING, sequence.run(50));
+  TEST_ASSERT_EQUAL(1000000, sim::clockMs);
+  TEST_ASSERT_EQUAL(200, *sequence.getMillisUntilDeadline());
+
+  sim::clockMs += 150;
+  TEST_ASSERT_EQUAL(State::RUNNING, sequence.run(50));
+  TEST_ASSERT_EQUAL(50, *sequence.getMillisUntilDeadline());
+  sim::clockMs += 50;
+  TEST_ASSERT_EQUAL(State::DONE, sequence.run(50));
+}
+
+void test_notification_wait() {
+  HandshakeSequence sequence;
+  sequence.addNotificationWait("ready", isReady, 1000);
+
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::RUNNING, sequence.run(50));
+  TEST_ASSERT_FALSE(sequence.onNotification(OTHER, sizeof(OTHER)));
+  sim::clockMs += 100;
+  TEST_ASSERT_EQUAL(State::RUNNING, sequence.run(50));
+  TEST_ASSERT_EQUAL(900, *sequence.getMillisUntilDeadline());
+
+  TEST_ASSERT_TRUE(sequence.onNotification(READY, sizeof(READY)));
+  TEST_ASSERT_EQUAL(0, *sequence.getMillisUntilDeadline());
+  TEST_ASSERT_FALSE(sequence.onNotification(READY, sizeof(READY)));
+  TEST_ASSERT_EQUAL(State::DONE, sequence.run(50));
+}
+
+void test_notification_wait_times_out() {
+  HandshakeSequence sequence;
+  sequence.addNotificationWait("ready", isReady, 1000);
+
+  sequence.start();
+  sim::clockMs += 999;
+  TEST_ASSERT_EQUAL(State::RUNNING, sequence.run(50));
+  sim::clockMs += 1;
+  TEST_ASSERT_EQUAL(State::FAILED, sequence.run(50));
+  TEST_ASSERT_EQUAL_STRING("ready", sequence.getStepName());
+  TEST_ASSERT_FALSE(sequence.onNotification(READY, sizeof(READY)));
+}
+
+// The answer to a write can arrive before run() gets to the step that waits for it.
+void test_notification_during_the_step_before_counts() {
+  HandshakeSequence sequence;
+  sequence.addAction("identify", [&]() { return sequence.onNotification(READY, sizeof(READY)); });
+  sequence.addNotificationWait("ready", isReady, 1000);
+
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::DONE, sequence.run(50));
+}
+
+void test_notifications_before_the_step_before_are_ignored() {
+  HandshakeSequence sequence;
+  sequence.addAction("discover", []() { return true; });
+  sequence.addAction("identify", []() { return true; });
+  sequence.addNotificationWait("ready", isReady, 1000);
+
+  sequence.start();
+  TEST_ASSERT_FALSE(sequence.onNotification(READY, sizeof(READY)));
+  TEST_ASSERT_EQUAL(State::RUNNING, sequence.run(50));
+}
+
+void test_run_yields_once_the_slice_is_used_up() {
+  std::string ran;
+  HandshakeSequence sequence;
+  sequence.addAction("a", [&]() { ran += "a"; sim::clockMs += 30; return true; });
+  sequence.addAction("b", [&]() { ran += "b"; sim::clockMs += 30; return true; });
+  sequence.addAction("c", [&]() { ran += "c"; sim::clockMs += 30; return true; });
+
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::RUNNING, sequence.run(50));
+  TEST_ASSERT_EQUAL_STRING("ab", ran.c_str());
+  TEST_ASSERT_EQUAL(0, *sequence.getMillisUntilDeadline());
+  TEST_ASSERT_EQUAL_STRING("c", sequence.getStepName());
+
+  // At least one step per run(), even with no slice.
+  TEST_ASSERT_EQUAL(State::DONE, sequence.run(0));
+  TEST_ASSERT_EQUAL_STRING("abc", ran.c_str());
+}
+
+void test_cancel_from_an_action() {
+  bool ranLast = false;
+  HandshakeSequence sequence;
+  sequence.addAction("disconnect", [&]() { sequence.cancel(); return true; });
+  sequence.addAction("identify", [&]() { ranLast = true; return true; });
+
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::IDLE, sequence.run(50));
+  TEST_ASSERT_FALSE(ranLast);
+  TEST_ASSERT_FALSE(sequence.getMillisUntilDeadline().has_value());
+}
+
+// A cancel() and start() while an action runs, i.e. a reconnect, starts over instead of carrying on after it.
+void test_restart_from_an_action() {
+  std::string ran;
+  bool restarted = false;
+  HandshakeSequence sequence;
+  sequence.addAction("a", [&]() {
+    ran += "a";
+    if (!restarted) {
+      restarted = true;
+      sequence.cancel();
+      sequence.start();
+    }
+    return true;
+  });
+  sequence.addAction("b", [&]() { ran += "b"; return true; });
+
+  sequence.start();
+  TEST_ASSERT_EQUAL(State::RUNNING, sequence.run(50));
+  TEST_ASSERT_EQUAL_STRING("a", sequence.getStepName());
+  TEST_ASSERT_EQUAL(State::DONE, sequence.run(50));
+  TEST_ASSERT_EQUAL_STRING("aab", ran.c_str());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_actions_run_in_order);
+  RUN_TEST(test_failed_action_stops_the_handshake);
+  RUN_TEST(test_delay_waits_without_blocking);
+  RUN_TEST(test_notification_wait);
+  RUN_TEST(test_notification_wait_times_out);
+  RUN_TEST(test_notification_during_the_step_before_counts);
+  RUN_TEST(test_notifications_before_the_step_before_are_ignored);
+  RUN_TEST(test_run_yields_once_the_slice_is_used_up);
+  RUN_TEST(test_cancel_from_an_action);
+  RUN_TEST(test_restart_from_an_action);
+  return UNITY_END();
+}
@@ -0,0 +1,182 @@
+#include <unity.h>
+#include "remote_scales.h"
+
+// Heartbeat suppression of KeepalivePolicy::ADAPTIVE scales. Time is the simulated clock of
+// test/fakes/Arduino.h and the connection runs over the simulated link of test/fakes/NimBLEDevice.h.
+// The tolerances learned are kept per address for the whole run, so every test uses its own address.
+
+namespace {
+
+constexpr uint32_t HEARTBEAT_MS = 100;
+constexpr uint32_t STEP_MS = 10;  // How often the application calls update(), and the scale notifies
+
+class KeepaliveScales : public RemoteScales {
+public:
+  explicit KeepaliveScales(uint64_t address) : KeepaliveScales(advertisedDevice(address)) {}
+
+  uint32_t heartbeatAt = 0;  // When the scale last got a heartbeat
+
+  bool tare() override { return true; }
+  bool isConnected() override { return clientIsConnected(); }
+  bool connect() override {
+    if (!clientConnect()) {
+      return false;
+    }
+    setTimerInterval(ScaleTimer::HEARTBEAT, HEARTBEAT_MS);
+    startTimer(ScaleTimer::HEARTBEAT);
+    heartbeatAt = millis();
+    return true;
+  }
+  void disconnect() override { clientCleanup(); }
+  void update() override { runTimers(); }
+
+  void notify() { setWeightMilligrams(12300); }
+
+protected:
+  void onTimer(ScaleTimer timer) override { heartbeatAt = millis(); }
+
+private:
+  explicit KeepaliveScales(NimBLEAdvertisedDevice device) : RemoteScales(DiscoveredDevice(&device)) {
+    setKeepalivePolicy(KeepalivePolicy::ADAPTIVE);
+  }
+  static NimBLEAdvertisedDevice advertisedDevice(uint64_t address) { return NimBLEAdvertisedDevice("Keepalive", NimBLEAddress(address)); }
+};
+
+// A scale that notifies every step while its last heartbeat is less than toleranceMs ago. Past that it goes
+// quiet until the next heartbeat, or ends the connection if dropsLink is set.
+struct SimulatedScale {
+  sim::Peer peer;
+  uint32_t toleranceMs;
+  bool dropsLink = false;
+  uint32_t drops = 0;
+
+  SimulatedScale(uint64_t address, uint32_t toleranceMs) : toleranceMs(toleranceMs) {
+    peer.name = "Keepalive";
+    peer.address = NimBLEAddress(address);
+    sim::Link::get().addPeer(&peer);
+  }
+  ~SimulatedScale() { sim::Link::get().removePeer(&peer); }
+
+  void run(KeepaliveScales& scales, uint32_t forMs) {
+    for (uint32_t elapsedMs = 0; elapsedMs < forMs; elapsedMs += STEP_MS) {
+      sim::clockMs += STEP_MS;
+      if (scales.isConnected()) {
+        if (millis() - scales.heartbeatAt < toleranceMs) {
+          scales.notify();
+        }
+        else if (dropsLink) {
+          drops++;
+          sim::Link::get().dropPeer(&peer);
+        }
+      }
+      scales.update();
+    }
+  }
+};
+
+}  // namespace
+
+void setUp() {
+  sim::clockMs = 1000000;
+  sim::Link::get().delays = sim::LinkDelays();
+}
+
+void tearDown() {}
+
+void test_gap_stretches_while_notifying() {
+  SimulatedScale scale(0x0B0000000001, UINT32_MAX);
+  KeepaliveScales scales(0x0B0000000001);
+  TEST_ASSERT_TRUE(scales.connect());
+
+  scale.run(scales, 5000);
+  KeepaliveStats stats = scales.getKeepaliveStats();
+  TEST_ASSERT_EQUAL(5 * HEARTBEAT_MS, stats.allowedGapMs);
+  TEST_ASSERT_EQUAL(0, stats.silenceToleranceMs);
+  TEST_ASSERT_TRUE(stats.skipped > stats.sent);
+}
+
+void test_silence_after_stretched_gap_is_learned() {
+  SimulatedScale scale(0x0B0000000002, 350);
+  KeepaliveScales scales(0x0B0000000002);
+  TEST_ASSERT_TRUE(scales.connect());
+
+  scale.run(scales, 3000);
+  KeepaliveStats stats = scales.getKeepaliveStats();
+  TEST_ASSERT_EQUAL(340, stats.silenceToleranceMs);  // The last notification before it went quiet
+  TEST_ASSERT_EQUAL(240, stats.allowedGapMs);
+
+  // Heartbeats stay below what the scale tolerates, it doesn't go quiet again.
+  uint32_t lastTrafficBefore = scales.getSnapshot().timestamp;
+  scale.run(scales, 3000);
+  TEST_ASSERT_EQUAL(340, scales.getKeepaliveStats().silenceToleranceMs);
+  TEST_ASSERT_TRUE(millis() - scales.getSnapshot().timestamp <= STEP_MS);
+  TEST_ASSERT_TRUE(scales.getSnapshot().timestamp > lastTrafficBefore);
+}
+
+void test_link_loss_after_stretched_gap_is_learned_and_kept_across_the_reconnect() {
+  SimulatedScale scale(0x0B0000000003, 350);
+  scale.dropsLink = true;
+  KeepaliveScales scales(0x0B0000000003);
+  TEST_ASSERT_TRUE(scales.connect());
+
+  scale.run(scales, 3000);
+  TEST_ASSERT_EQUAL(1, scale.drops);
+  TEST_ASSERT_TRUE(scales.isConnected());
+  TEST_ASSERT_EQUAL(340, scales.getKeepaliveStats().silenceToleranceMs);
+
+  // The new connection doesn't stretch into the same silence again.
+  scale.run(scales, 5000);
+  TEST_ASSERT_EQUAL(1, scale.drops);
+  TEST_ASSERT_EQUAL(340, scales.getKeepaliveStats().silenceToleranceMs);
+  TEST_ASSERT_TRUE(scales.getKeepaliveStats().allowedGapMs < 340);
+}
+
+void test_learned_tolerance_outlives_the_scales_object() {
+  {
+    SimulatedScale scale(0x0B0000000004, 350);
+    KeepaliveScales scales(0x0B0000000004);
+    TEST_ASSERT_TRUE(scales.connect());
+    scale.run(scales, 3000);
+    TEST_ASSERT_EQUAL(340, scales.getKeepaliveStats().silenceToleranceMs);
+    scales.disconnect();
+  }
+
+  SimulatedScale scale(0x0B0000000004, 350);
+  KeepaliveScales scales(0x0B0000000004);
+  TEST_ASSERT_TRUE(scales.connect());
+  TEST_ASSERT_EQUAL(340, scales.getKeepaliveStats().silenceToleranceMs);
+  scale.run(scales, 3000);
+  TEST_ASSERT_TRUE(millis() - scales.getSnapshot().timestamp <= STEP_MS);
+
+  // Other scales learn their own.
+  SimulatedScale otherScale(0x0B0000000005, UINT32_MAX);
+  KeepaliveScales otherScales(0x0B0000000005);
+  TEST_ASSERT_TRUE(otherScales.connect());
+  TEST_ASSERT_EQUAL(0, otherScales.getKeepaliveStats().silenceToleranceMs);
+}
+
+void test_gap_stays_below_the_watchdog_window() {
+  SimulatedScale scale(0x0B0000000006, UINT32_MAX);
+  KeepaliveScales scales(0x0B0000000006);
+  scales.setTimerInterval(ScaleTimer::WATCHDOG, 250);
+  TEST_ASSERT_TRUE(scales.connect());
+
+  scale.run(scales, 3000);
+  TEST_ASSERT_EQUAL(2 * HEARTBEAT_MS, scales.getKeepaliveStats().allowedGapMs);
+  TEST_ASSERT_EQUAL(0, scales.getStallStats().stalls);
+
+  // Below one interval nothing is skipped.
+  scales.setTimerInterval(ScaleTimer::WATCHDOG, 50);
+  scale.run(scales, 1000);
+  TEST_ASSERT_EQUAL(HEARTBEAT_MS, scales.getKeepaliveStats().allowedGapMs);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_gap_stretches_while_notifying);
+  RUN_TEST(test_silence_after_stretched_gap_is_learned);
+  RUN_TEST(test_link_loss_after_stretched_gap_is_learned_and_kept_across_the_reconnect);
+  RUN_TEST(test_learned_tolerance_outlives_the_scales_object);
+  RUN_TEST(test_gap_stays_below_the_watchdog_window);
+  return UNITY_END();
+}
@@ -0,0 +1,204 @@
+#include <unity.h>
+#include "shot_recorder.h"
+
+// Shots go through the ring arena and come back out of ShotDecoder exactly as recorded, rounded to the
+// recorder's weight resolution.
+
+namespace {
+
+std::vector<WeightSample> record(ShotRecorder& recorder, const std::vector<WeightSample>& samples) {
+  TEST_ASSERT_TRUE(recorder.start());
+  for (const auto& sample : samples) {
+    recorder.addSample(sample);
+  }
+  recorder.stop();
+  return samples;
+}
+
+// A pour at 10Hz, about 2 bytes per sample.
+std::vector<WeightSample> pour(size_t count, uint32_t startedAt, int32_t stepMg = 150) {
+  std::vector<WeightSample> samples;
+  for (size_t i = 0; i < count; i++) {
+    samples.push_back(WeightSample{ static_cast<int32_t>(i) * stepMg, startedAt + static_cast<uint32_t>(i) * 100 });
+  }
+  return samples;
+}
+
+std::vector<WeightSample> decode(ShotRecorder& recorder, size_t index, bool& truncated) {
+  std::vector<uint8_t> shot;
+  TEST_ASSERT_TRUE(recorder.exportShot(index, shot));
+  ShotDecoder decoder(shot);
+  TEST_ASSERT_TRUE(decoder.isValid());
+  truncated = decoder.isTruncated();
+
+  std::vector<WeightSample> samples;
+  WeightSample sample;
+  while (decoder.next(sample)) {
+    samples.push_back(sample);
+  }
+  TEST_ASSERT_TRUE(decoder.isValid());
+  TEST_ASSERT_EQUAL(decoder.getSampleCount(), samples.size());
+  if (!samples.empty()) {
+    TEST_ASSERT_EQUAL(samples[0].timestamp, decoder.getStartTimestamp());
+  }
+  return samples;
+}
+
+void assertSamplesEqual(const std::vector<WeightSample>& expected, const std::vector<WeightSample>& actual) {
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    TEST_ASSERT_EQUAL(expected[i].timestamp, actual[i].timestamp);
+    TEST_ASSERT_EQUAL(expected[i].weightMg, actual[i].weightMg);
+  }
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_round_trip() {
+  ShotRecorder recorder(4096, 10);
+  std::vector<WeightSample> samples = record(recorder, pour(300, 5000));
+
+  bool truncated;
+  assertSamplesEqual(samples, decode(recorder, 0, truncated));
+  TEST_ASSERT_FALSE(truncated);
+  TEST_ASSERT_EQUAL(1, recorder.getShotCount());
+  // Two bytes per sample at 10Hz and 15g/s.
+  TEST_ASSERT_EQUAL(12 + 300 * 2, recorder.getBytesUsed());
+}
+
+void test_negative_deltas() {
+  ShotRecorder recorder(4096, 10);
+  std::vector<WeightSample> samples = record(recorder, {
+    { 0, 1000 }, { -20, 1100 }, { -5000, 1200 }, { 36000, 1300 }, { 35990, 1400 }, { -36000, 1500 },
+  });
+
+  bool truncated;
+  assertSamplesEqual(samples, decode(recorder, 0, truncated));
+}
+
+void test_weights_are_rounded_to_the_resolution() {
+  ShotRecorder recorder(4096, 10);
+  record(recorder, { { 14, 0 }, { 15, 100 }, { -14, 200 }, { -15, 300 }, { 1234, 400 } });
+
+  bool truncated;
+  assertSamplesEqual({ { 10, 0 }, { 20, 100 }, { -10, 200 }, { -20, 300 }, { 1230, 400 } }, decode(recorder, 0, truncated));
+}
+
+// Deltas that need all five bytes of a varint.
+void test_values_that_fill_the_varint() {
+  ShotRecorder recorder(4096, 1);
+  std::vector<WeightSample> samples = record(recorder, {
+    { 0, 0 },
+    { 1000000000, 0xFFFFFFFF },
+    { -1000000000, 0xFFFFFFFF },
+    { 0, 0x10000000 },
+    { 1, 0x10000001 },
+  });
+
+  bool truncated;
+  assertSamplesEqual(samples, decode(recorder, 0, truncated));
+}
+
+// 0 would divide by zero, it is taken as 1mg.
+void test_resolution_zero() {
+  ShotRecorder recorder(4096, 0);
+  std::vector<WeightSample> samples = record(recorder, { { 1, 0 }, { -7, 100 }, { 12345, 200 } });
+
+  std::vector<uint8_t> shot;
+  TEST_ASSERT_TRUE(recorder.exportShot(0, shot));
+  TEST_ASSERT_EQUAL(1, shot[11]);
+  bool truncated;
+  assertSamplesEqual(samples, decode(recorder, 0, truncated));
+}
+
+// The second shot doesn't fit behind the first, which is dropped, and wraps around the end of the arena.
+void test_arena_wrap() {
+  ShotRecorder recorder(1000, 10);
+  record(recorder, pour(200, 0));
+  TEST_ASSERT_EQUAL(412, recorder.getBytesUsed());
+
+  std::vector<WeightSample> samples = record(recorder, pour(300, 60000));
+  TEST_ASSERT_EQUAL(1, recorder.getShotCount());
+  TEST_ASSERT_EQUAL(612, recorder.getBytesUsed());
+  bool truncated;
+  assertSamplesEqual(samples, decode(recorder, 0, truncated));
+  TEST_ASSERT_FALSE(truncated);
+
+  // Once more, starting where the wrapped shot ended.
+  samples = record(recorder, pour(150, 120000));
+  TEST_ASSERT_EQUAL(1, recorder.getShotCount());
+  assertSamplesEqual(samples, decode(recorder, 0, truncated));
+}
+
+// The oldest shot makes room while the next one is still being recorded.
+void test_oldest_shot_is_evicted_while_recording() {
+  ShotRecorder recorder(1000, 10);
+  std::vector<WeightSample> first = record(recorder, pour(50, 0));
+  std::vector<WeightSample> second = record(recorder, pour(100, 10000));
+  TEST_ASSERT_EQUAL(2, recorder.getShotCount());
+
+  std::vector<WeightSample> third = record(recorder, pour(350, 20000));
+  TEST_ASSERT_EQUAL(2, recorder.getShotCount());
+  bool truncated;
+  assertSamplesEqual(second, decode(recorder, 0, truncated));
+  assertSamplesEqual(third, decode(recorder, 1, truncated));
+  TEST_ASSERT_FALSE(truncated);
+  std::vector<uint8_t> shot;
+  TEST_ASSERT_FALSE(recorder.exportShot(2, shot));
+}
+
+// Only a shot that fills the whole arena on its own is cut short.
+void test_shot_larger_than_the_arena_is_truncated() {
+  ShotRecorder recorder(1000, 10);
+  record(recorder, pour(100, 0));
+  std::vector<WeightSample> samples = record(recorder, pour(1000, 20000));
+
+  TEST_ASSERT_EQUAL(1, recorder.getShotCount());
+  TEST_ASSERT_LESS_OR_EQUAL(1000, recorder.getBytesUsed());
+  bool truncated;
+  std::vector<WeightSample> decoded = decode(recorder, 0, truncated);
+  TEST_ASSERT_TRUE(truncated);
+  TEST_ASSERT_EQUAL((1000 - 12) / 2, decoded.size());
+  samples.resize(decoded.size());
+  assertSamplesEqual(samples, decoded);
+}
+
+void test_corrupt_shot_is_rejected() {
+  ShotRecorder recorder(4096, 10);
+  record(recorder, pour(10, 0));
+  std::vector<uint8_t> shot;
+  TEST_ASSERT_TRUE(recorder.exportShot(0, shot));
+
+  // A varint that never ends.
+  std::vector<uint8_t> unterminated = shot;
+  for (size_t i = 12; i < unterminated.size(); i++) {
+    unterminated[i] = 0xFF;
+  }
+  ShotDecoder decoder(unterminated);
+  WeightSample sample;
+  TEST_ASSERT_TRUE(decoder.isValid());
+  TEST_ASSERT_FALSE(decoder.next(sample));
+  TEST_ASSERT_FALSE(decoder.isValid());
+
+  std::vector<uint8_t> cut(shot.begin(), shot.end() - 1);
+  TEST_ASSERT_FALSE(ShotDecoder(cut).isValid());
+  TEST_ASSERT_FALSE(ShotDecoder(shot.data(), 11).isValid());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_negative_deltas);
+  RUN_TEST(test_weights_are_rounded_to_the_resolution);
+  RUN_TEST(test_values_that_fill_the_varint);
+  RUN_TEST(test_resolution_zero);
+  RUN_TEST(test_arena_wrap);
+  RUN_TEST(test_oldest_shot_is_evicted_while_recording);
+  RUN_TEST(test_shot_larger_than_the_arena_is_truncated);
+  RUN_TEST(test_corrupt_shot_is_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,267 @@
+#include <unity.h>
+#include "remote_scales.h"
+
+// The heartbeat, data-stall watchdog, reconnect and tare timers of every scale run on this wheel. Time is
+// the simulated clock of test/fakes/Arduino.h. Only HEARTBEAT reaches the driver's onTimer(), the other
+// timers are handled by RemoteScales itself, so most tests use heartbeats and TARE shows up in the tare stats.
+
+namespace {
+
+constexpr uint32_t REVOLUTION_MS = RemoteScalesTimerWheel::TICK_MS * RemoteScalesTimerWheel::SLOT_COUNT;
+
+RemoteScalesTimerWheel* wheel() {
+  return RemoteScalesTimerWheel::getInstance();
+}
+
+class TimedScales : public RemoteScales {
+public:
+  TimedScales() : TimedScales(advertisedDevice()) {}
+
+  std::vector<uint32_t> firedAt;
+  std::function<void()> onHeartbeat = nullptr;
+
+  bool tare() override { return true; }
+  bool isConnected() override { return false; }
+  bool connect() override { return false; }
+  void disconnect() override {}
+  void update() override { runTimers(); }
+
+  void startHeartbeat(uint32_t intervalMs) {
+    setTimerInterval(ScaleTimer::HEARTBEAT, intervalMs);
+    startTimer(ScaleTimer::HEARTBEAT);
+  }
+
+protected:
+  void onTimer(ScaleTimer timer) override {
+    firedAt.push_back(millis());
+    if (onHeartbeat) {
+      onHeartbeat();
+    }
+  }
+
+private:
+  explicit TimedScales(NimBLEAdvertisedDevice device) : RemoteScales(DiscoveredDevice(&device)) {}
+  static NimBLEAdvertisedDevice advertisedDevice() { return NimBLEAdvertisedDevice("Timed", NimBLEAddress(0x0A0000000001)); }
+};
+
+// Calls update() every stepMs until untilMs, like the application's loop.
+void runUntil(TimedScales& scales, uint32_t untilMs, uint32_t stepMs = 1) {
+  while (static_cast<int32_t>(untilMs - millis()) > 0) {
+    sim::clockMs += std::min(stepMs, untilMs - millis());
+    scales.update();
+  }
+}
+
+}  // namespace
+
+void setUp() {
+  sim::clockMs = 1000000;
+}
+
+void tearDown() {}
+
+void test_one_shot_fires_once_at_its_deadline() {
+  TimedScales scales;
+  wheel()->schedule(&scales, ScaleTimer::HEARTBEAT, 120);
+  TEST_ASSERT_EQUAL(1, wheel()->size());
+
+  runUntil(scales, 1000119);
+  TEST_ASSERT_EQUAL(0, scales.firedAt.size());
+  runUntil(scales, 1000500);
+  TEST_ASSERT_EQUAL(1, scales.firedAt.size());
+  TEST_ASSERT_EQUAL(1000120, scales.firedAt[0]);
+  TEST_ASSERT_EQUAL(0, wheel()->size());
+  TEST_ASSERT_FALSE(wheel()->isScheduled(&scales, ScaleTimer::HEARTBEAT));
+}
+
+void test_periodic_keeps_its_period() {
+  TimedScales scales;
+  scales.startHeartbeat(100);
+
+  runUntil(scales, 1000350, 1);
+  TEST_ASSERT_EQUAL(3, scales.firedAt.size());
+  TEST_ASSERT_EQUAL(1000100, scales.firedAt[0]);
+  TEST_ASSERT_EQUAL(1000200, scales.firedAt[1]);
+  TEST_ASSERT_EQUAL(1000300, scales.firedAt[2]);
+
+  // An update() that comes late fires once and starts the period over from then.
+  sim::clockMs = 1001000;
+  scales.update();
+  TEST_ASSERT_EQUAL(4, scales.firedAt.size());
+  runUntil(scales, 1001099, 1);
+  TEST_ASSERT_EQUAL(4, scales.firedAt.size());
+  runUntil(scales, 1001100, 1);
+  TEST_ASSERT_EQUAL(5, scales.firedAt.size());
+}
+
+// Deadlines more than SLOT_COUNT ticks away share a slot with nearer ones and wait for their revolution.
+void test_delays_longer_than_a_revolution() {
+  TimedScales scales;
+  wheel()->schedule(&scales, ScaleTimer::HEARTBEAT, REVOLUTION_MS + 30);
+
+  runUntil(scales, 1000000 + REVOLUTION_MS + 29);
+  TEST_ASSERT_EQUAL(0, scales.firedAt.size());
+  runUntil(scales, 1000000 + REVOLUTION_MS + 40);
+  TEST_ASSERT_EQUAL(1, scales.firedAt.size());
+  TEST_ASSERT_EQUAL(1000000 + REVOLUTION_MS + 30, scales.firedAt[0]);
+
+  wheel()->schedule(&scales, ScaleTimer::HEARTBEAT, 3 * REVOLUTION_MS + 10);
+  runUntil(scales, millis() + 3 * REVOLUTION_MS + 9, 7);
+  TEST_ASSERT_EQUAL(1, scales.firedAt.size());
+  runUntil(scales, millis() + 10, 7);
+  TEST_ASSERT_EQUAL(2, scales.firedAt.size());
+}
+
+// An update() that comes more than a revolution late still finds the timer.
+void test_update_more_than_a_revolution_late() {
+  TimedScales scales;
+  wheel()->schedule(&scales, ScaleTimer::HEARTBEAT, 100);
+
+  sim::clockMs += 5 * REVOLUTION_MS + 70;
+  scales.update();
+  TEST_ASSERT_EQUAL(1, scales.firedAt.size());
+}
+
+void test_deadline_after_the_clock_wraps() {
+  sim::clockMs = 0xFFFFFF00;
+  TimedScales scales;
+  scales.startHeartbeat(200);
+
+  runUntil(scales, 0x00000100, 4);
+  TEST_ASSERT_EQUAL(2, scales.firedAt.size());
+  TEST_ASSERT_EQUAL(0xFFFFFF00 + 200, scales.firedAt[0]);
+  TEST_ASSERT_EQUAL(0xFFFFFF00 + 400, scales.firedAt[1]);
+  runUntil(scales, 0x00000100 + 400, 4);
+  TEST_ASSERT_EQUAL(4, scales.firedAt.size());
+  TEST_ASSERT_EQUAL(0xFFFFFF00 + 800, scales.firedAt[3]);
+}
+
+void test_schedule_again_replaces_the_timer() {
+  TimedScales scales;
+  wheel()->schedule(&scales, ScaleTimer::HEARTBEAT, 100);
+  wheel()->schedule(&scales, ScaleTimer::HEARTBEAT, 300);
+  TEST_ASSERT_EQUAL(1, wheel()->size());
+
+  runUntil(scales, 1000299);
+  TEST_ASSERT_EQUAL(0, scales.firedAt.size());
+  runUntil(scales, 1001000);
+  TEST_ASSERT_EQUAL(1, scales.firedAt.size());
+  TEST_ASSERT_EQUAL(1000300, scales.firedAt[0]);
+}
+
+void test_cancel() {
+  TimedScales scales;
+  scales.startHeartbeat(100);
+  wheel()->cancel(&scales, ScaleTimer::HEARTBEAT);
+
+  TEST_ASSERT_FALSE(wheel()->isScheduled(&scales, ScaleTimer::HEARTBEAT));
+  TEST_ASSERT_EQUAL(0, wheel()->size());
+  runUntil(scales, 1001000);
+  TEST_ASSERT_EQUAL(0, scales.firedAt.size());
+
+  // And scheduled again after cancelling.
+  scales.startHeartbeat(100);
+  runUntil(scales, 1001100);
+  TEST_ASSERT_EQUAL(1, scales.firedAt.size());
+}
+
+void test_periodic_timer_cancelled_from_its_callback_stops() {
+  TimedScales scales;
+  scales.startHeartbeat(100);
+  scales.onHeartbeat = [&]() { wheel()->cancel(&scales, ScaleTimer::HEARTBEAT); };
+
+  runUntil(scales, 1001000);
+  TEST_ASSERT_EQUAL(1, scales.firedAt.size());
+  TEST_ASSERT_EQUAL(0, wheel()->size());
+}
+
+// Timers due in the same update() fire in deadline order, and cancelAll() from one of them stops the rest.
+void test_cancel_all_during_dispatch() {
+  TimedScales scales;
+  scales.tareAsync(120);
+  scales.startHeartbeat(60);
+  TEST_ASSERT_EQUAL(2, wheel()->size());
+
+  sim::clockMs += 150;
+  scales.onHeartbeat = [&]() { wheel()->cancelAll(&scales); };
+  scales.update();
+  TEST_ASSERT_EQUAL(1, scales.firedAt.size());
+  TEST_ASSERT_EQUAL(0, scales.getTareStats().timedOut);
+  TEST_ASSERT_EQUAL(0, wheel()->size());
+}
+
+void test_due_timers_fire_in_deadline_order() {
+  TimedScales scales;
+  scales.tareAsync(60);
+  scales.startHeartbeat(120);
+  uint32_t timedOutBeforeHeartbeat = UINT32_MAX;
+  scales.onHeartbeat = [&]() { timedOutBeforeHeartbeat = scales.getTareStats().timedOut; };
+
+  sim::clockMs += 150;
+  scales.update();
+  TEST_ASSERT_EQUAL(1, timedOutBeforeHeartbeat);
+}
+
+void test_scales_fire_only_their_own_timers() {
+  TimedScales first;
+  TimedScales second;
+  first.startHeartbeat(100);
+  second.startHeartbeat(100);
+
+  sim::clockMs += 100;
+  first.update();
+  TEST_ASSERT_EQUAL(1, first.firedAt.size());
+  TEST_ASSERT_EQUAL(0, second.firedAt.size());
+  sim::clockMs += 30;
+  second.update();
+  TEST_ASSERT_EQUAL(1, second.firedAt.size());
+  TEST_ASSERT_EQUAL(1000130, second.firedAt[0]);
+}
+
+void test_destroyed_scales_leave_no_timers() {
+  {
+    TimedScales scales;
+    scales.startHeartbeat(100);
+    scales.tareAsync(500);
+    TEST_ASSERT_EQUAL(2, wheel()->size());
+  }
+  TEST_ASSERT_EQUAL(0, wheel()->size());
+  TEST_ASSERT_FALSE(wheel()->getMillisUntilNextDeadline().has_value());
+}
+
+void test_millis_until_next_deadline() {
+  TimedScales scales;
+  TEST_ASSERT_FALSE(wheel()->getMillisUntilNextDeadline().has_value());
+
+  scales.startHeartbeat(300);
+  scales.tareAsync(120);
+  TEST_ASSERT_EQUAL(120, *wheel()->getMillisUntilNextDeadline());
+  sim::clockMs += 50;
+  TEST_ASSERT_EQUAL(70, *wheel()->getMillisUntilNextDeadline());
+  // Overdue until update() runs it.
+  sim::clockMs += 100;
+  TEST_ASSERT_EQUAL(0, *wheel()->getMillisUntilNextDeadline());
+  scales.update();
+  TEST_ASSERT_EQUAL(150, *wheel()->getMillisUntilNextDeadline());
+
+  wheel()->cancelAll(&scales);
+  TEST_ASSERT_FALSE(wheel()->getMillisUntilNextDeadline().has_value());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_one_shot_fires_once_at_its_deadline);
+  RUN_TEST(test_periodic_keeps_its_period);
+  RUN_TEST(test_delays_longer_than_a_revolution);
+  RUN_TEST(test_update_more_than_a_revolution_late);
+  RUN_TEST(test_deadline_after_the_clock_wraps);
+  RUN_TEST(test_schedule_again_replaces_the_timer);
+  RUN_TEST(test_cancel);
+  RUN_TEST(test_periodic_timer_cancelled_from_its_callback_stops);
+  RUN_TEST(test_cancel_all_during_dispatch);
+  RUN_TEST(test_due_timers_fire_in_deadline_order);
+  RUN_TEST(test_scales_fire_only_their_own_timers);
+  RUN_TEST(test_destroyed_scales_leave_no_timers);
+  RUN_TEST(test_millis_until_next_deadline);
+  return UNITY_END();
+}